@@ -39,11 +39,23 @@ EMSCRIPTEN_BINDINGS(ggwave) {
         .value("GGWAVE_PROTOCOL_CUSTOM_9", GGWAVE_PROTOCOL_CUSTOM_9)
         ;
 
-    emscripten::constant("GGWAVE_OPERATING_MODE_RX",            (int) GGWAVE_OPERATING_MODE_RX);
-    emscripten::constant("GGWAVE_OPERATING_MODE_TX",            (int) GGWAVE_OPERATING_MODE_TX);
-    emscripten::constant("GGWAVE_OPERATING_MODE_RX_AND_TX",     (int) GGWAVE_OPERATING_MODE_RX | GGWAVE_OPERATING_MODE_TX);
-    emscripten::constant("GGWAVE_OPERATING_MODE_TX_ONLY_TONES", (int) GGWAVE_OPERATING_MODE_TX_ONLY_TONES);
-    emscripten::constant("GGWAVE_OPERATING_MODE_USE_DSS",       (int) GGWAVE_OPERATING_MODE_USE_DSS);
+    emscripten::enum_<ggwave_ResamplerType>("ResamplerType")
+        .value("GGWAVE_RESAMPLER_SINC",      GGWAVE_RESAMPLER_SINC)
+        .value("GGWAVE_RESAMPLER_POLYPHASE", GGWAVE_RESAMPLER_POLYPHASE)
+        ;
+
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX",                (int) GGWAVE_OPERATING_MODE_RX);
+    emscripten::constant("GGWAVE_OPERATING_MODE_TX",                (int) GGWAVE_OPERATING_MODE_TX);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX_AND_TX",         (int) GGWAVE_OPERATING_MODE_RX | GGWAVE_OPERATING_MODE_TX);
+    emscripten::constant("GGWAVE_OPERATING_MODE_TX_ONLY_TONES",     (int) GGWAVE_OPERATING_MODE_TX_ONLY_TONES);
+    emscripten::constant("GGWAVE_OPERATING_MODE_USE_DSS",           (int) GGWAVE_OPERATING_MODE_USE_DSS);
+    emscripten::constant("GGWAVE_OPERATING_MODE_TX_STREAMING",      (int) GGWAVE_OPERATING_MODE_TX_STREAMING);
+    emscripten::constant("GGWAVE_OPERATING_MODE_TX_SYMBOL_CACHE",   (int) GGWAVE_OPERATING_MODE_TX_SYMBOL_CACHE);
+    emscripten::constant("GGWAVE_OPERATING_MODE_TX_NCO",            (int) GGWAVE_OPERATING_MODE_TX_NCO);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX_ANALYSIS_CACHE", (int) GGWAVE_OPERATING_MODE_RX_ANALYSIS_CACHE);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX_ASYNC_ANALYSIS", (int) GGWAVE_OPERATING_MODE_RX_ASYNC_ANALYSIS);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX_ENERGY_GATE",    (int) GGWAVE_OPERATING_MODE_RX_ENERGY_GATE);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX_RECORD_I16",     (int) GGWAVE_OPERATING_MODE_RX_RECORD_I16);
 
     emscripten::value_object<ggwave_Parameters>("Parameters")
         .field("payloadLength",        & ggwave_Parameters::payloadLength)
@@ -55,6 +67,11 @@ EMSCRIPTEN_BINDINGS(ggwave) {
         .field("sampleFormatInp",      & ggwave_Parameters::sampleFormatInp)
         .field("sampleFormatOut",      & ggwave_Parameters::sampleFormatOut)
         .field("operatingMode",        & ggwave_Parameters::operatingMode)
+        .field("resamplerType",        & ggwave_Parameters::resamplerType)
+        .field("resamplerQuality",     & ggwave_Parameters::resamplerQuality)
+        .field("analysisBudget",       & ggwave_Parameters::analysisBudget)
+        .field("analysisWorkers",      & ggwave_Parameters::analysisWorkers)
+        .field("markerHop",            & ggwave_Parameters::markerHop)
         ;
 
     emscripten::function("getDefaultParameters", & ggwave_getDefaultParameters);
@@ -66,16 +83,21 @@ EMSCRIPTEN_BINDINGS(ggwave) {
                        const std::string & data,
                        ggwave_ProtocolId protocolId,
                        int volume) {
-                        auto n = ggwave_encode(instance, data.data(), data.size(), protocolId, volume, nullptr, 1);
-
                         // TODO: how to return the waveform data?
                         //       for now using this static vector and returning a pointer to it
-                        static std::vector<char> result(n);
-                        result.resize(n);
+                        static std::vector<char> result;
 
-                        int nActual = ggwave_encode(instance, data.data(), data.size(), protocolId, volume, result.data(), 0);
+                        // encode directly into the static vector and grow it only if it is too small
+                        int nActual = ggwave_nencode(instance, data.data(), data.size(), protocolId, volume, result.data(), result.size());
+                        if (nActual > (int) result.size()) {
+                            result.resize(nActual);
+                            nActual = ggwave_nencode(instance, data.data(), data.size(), protocolId, volume, result.data(), result.size());
+                        }
+
+                        if (nActual < 0) {
+                            nActual = 0;
+                        }
 
-                        // printf("n = %d, nActual = %d\n", n, nActual);
                         return emscripten::val(emscripten::typed_memory_view(nActual, result.data()));
                     }));
 
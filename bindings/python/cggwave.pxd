@@ -38,7 +38,18 @@ cdef extern from "ggwave.h" nogil:
         GGWAVE_OPERATING_MODE_TX,
         GGWAVE_OPERATING_MODE_RX_AND_TX,
         GGWAVE_OPERATING_MODE_TX_ONLY_TONES,
-        GGWAVE_OPERATING_MODE_USE_DSS
+        GGWAVE_OPERATING_MODE_USE_DSS,
+        GGWAVE_OPERATING_MODE_TX_STREAMING,
+        GGWAVE_OPERATING_MODE_TX_SYMBOL_CACHE,
+        GGWAVE_OPERATING_MODE_TX_NCO,
+        GGWAVE_OPERATING_MODE_RX_ANALYSIS_CACHE,
+        GGWAVE_OPERATING_MODE_RX_ASYNC_ANALYSIS,
+        GGWAVE_OPERATING_MODE_RX_ENERGY_GATE,
+        GGWAVE_OPERATING_MODE_RX_RECORD_I16
+
+    ctypedef enum ggwave_ResamplerType:
+        GGWAVE_RESAMPLER_SINC,
+        GGWAVE_RESAMPLER_POLYPHASE
 
     ctypedef struct ggwave_Parameters:
         int payloadLength
@@ -50,6 +61,11 @@ cdef extern from "ggwave.h" nogil:
         ggwave_SampleFormat sampleFormatInp
         ggwave_SampleFormat sampleFormatOut
         int operatingMode
+        ggwave_ResamplerType resamplerType
+        int resamplerQuality
+        int analysisBudget
+        int analysisWorkers
+        int markerHop
 
     ctypedef int ggwave_Instance
 
@@ -68,6 +84,15 @@ cdef extern from "ggwave.h" nogil:
             void * waveformBuffer,
             int query);
 
+    int ggwave_nencode(
+            ggwave_Instance instance,
+            const void * payloadBuffer,
+            int payloadSize,
+            ggwave_ProtocolId protocolId,
+            int volume,
+            void * waveformBuffer,
+            int waveformSize);
+
     int ggwave_decode(
             ggwave_Instance instance,
             const void * waveformBuffer,
@@ -37,16 +37,19 @@ def encode(payload, protocolId = 1, volume = 10, instance = None):
         own = True
         instance = init(getDefaultParameters())
 
-    n = cggwave.ggwave_encode(instance, cdata, len(data_bytes), protocolId, volume, NULL, 1)
+    n = cggwave.ggwave_nencode(instance, cdata, len(data_bytes), protocolId, volume, NULL, 0)
 
     cdef bytes output_bytes = bytes(n)
     cdef char* coutput = output_bytes
 
-    n = cggwave.ggwave_encode(instance, cdata, len(data_bytes), protocolId, volume, coutput, 0)
+    n = cggwave.ggwave_nencode(instance, cdata, len(data_bytes), protocolId, volume, coutput, len(output_bytes))
 
     if (own):
         free(instance)
 
+    if (n < len(output_bytes)):
+        return output_bytes[0:n]
+
     return output_bytes
 
 def decode(instance, waveform):
@@ -238,6 +238,11 @@ bool GGWave_init(
             sampleFormatInp,
             sampleFormatOut,
             mode,
+            GGWAVE_RESAMPLER_POLYPHASE,
+            GGWave::kDefaultResamplerQuality,
+            0,
+            0,
+            0,
         });
     }
 
@@ -0,0 +1,283 @@
+#include "ggwave/ggwave.h"
+
+#include "ggwave-common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Format {
+    const char * name;
+    GGWave::SampleFormat format;
+};
+
+const Format kFormats[] = {
+    { "U8",  GGWAVE_SAMPLE_FORMAT_U8  },
+    { "I8",  GGWAVE_SAMPLE_FORMAT_I8  },
+    { "U16", GGWAVE_SAMPLE_FORMAT_U16 },
+    { "I16", GGWAVE_SAMPLE_FORMAT_I16 },
+    { "F32", GGWAVE_SAMPLE_FORMAT_F32 },
+};
+
+void parallelExecutor(GGWave * instance, int nWorkers, void * ) {
+    std::vector<std::thread> threads;
+    for (int i = 1; i < nWorkers; ++i) {
+        threads.emplace_back([instance, i]() { instance->rxAnalysisWorker(i); });
+    }
+    instance->rxAnalysisWorker(0);
+    for (auto & thread : threads) {
+        thread.join();
+    }
+}
+
+// measure the analysis of a variable-length capture for which the start marker cannot be
+// located, so that all protocols and offsets are searched
+int benchAnalysis(const std::string & payload, int protocolId, int nIter, int maxWorkers) {
+    std::vector<char> waveform;
+    {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.operatingMode = GGWAVE_OPERATING_MODE_TX;
+
+        GGWave ggWave(parameters);
+        if (ggWave.init((int) payload.size(), payload.data(), (GGWave::TxProtocolId) protocolId, 25) == false) {
+            fprintf(stderr, "Failed to initialize the payload\n");
+            return -1;
+        }
+
+        const int nBytes = ggWave.encode();
+        const char * p = (const char *) ggWave.txWaveform();
+        waveform.assign(p, p + nBytes);
+
+        const int frameSize = ggWave.samplesPerFrame()*ggWave.sampleSizeOut();
+        const int nMarkerBytes = GGWave::kDefaultMarkerFrames*frameSize;
+        std::fill(waveform.begin() + nMarkerBytes - 4*frameSize, waveform.begin() + nMarkerBytes, 0);
+    }
+
+    printf("analysis of a %d byte payload, analyses: %d\n\n", (int) payload.size(), nIter);
+    printf("%-8s %12s %12s %12s\n", "workers", "FFTs", "ms/analysis", "speedup");
+
+    double msSequential = 0.0;
+    for (int nWorkers = 1; nWorkers <= maxWorkers; nWorkers *= 2) {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.operatingMode   = GGWAVE_OPERATING_MODE_RX;
+        parameters.analysisWorkers = nWorkers;
+
+        GGWave ggWave(parameters);
+        ggWave.rxSetParallelExecutor(parallelExecutor, nullptr);
+
+        double ms = 0.0;
+        for (int i = 0; i < nIter; ++i) {
+            const auto tStart = std::chrono::steady_clock::now();
+            ggWave.decode(waveform.data(), (uint32_t) waveform.size());
+            const auto tEnd = std::chrono::steady_clock::now();
+
+            ms += std::chrono::duration<double, std::milli>(tEnd - tStart).count();
+
+            GGWave::TxRxData result;
+            if (ggWave.rxTakeData(result) != (int) payload.size()) {
+                fprintf(stderr, "Failed to decode the payload\n");
+                return -1;
+            }
+        }
+        ms /= nIter;
+
+        if (nWorkers == 1) {
+            msSequential = ms;
+        }
+
+        printf("%-8d %12d %12.3f %12.2f\n", nWorkers, ggWave.rxAnalysisStats().nFFTs/nIter, ms, msSequential/ms);
+    }
+
+    return 0;
+}
+
+// measure the real FFT of a frame with each FFT backend
+int benchFFT(int nIter) {
+    const GGWave::FFTBackend kBackends[] = { GGWAVE_FFT_BACKEND_OOURA, GGWAVE_FFT_BACKEND_SIMD };
+
+    // frames per computeFFTRBatch() call
+    const int kBatch = 8;
+
+    printf("real FFT, transforms per size: %d - 'xN' is a batch of N frames\n\n", 1000*nIter);
+    printf("%-6s %-8s %12s %12s %12s\n", "N", "backend", "ns/FFT", "speedup", "max diff");
+
+    for (int N = 256; N <= GGWave::kMaxSamplesPerFrame; N *= 2) {
+        std::vector<float> src(N);
+        std::vector<float> dst(2*N);
+        std::vector<float> ref(2*N);
+        std::vector<int>   wi(GGWave::computeFFTR(nullptr, nullptr, N, nullptr, nullptr));
+        std::vector<float> wf(GGWave::computeFFTR(nullptr, nullptr, N, wi.data(), nullptr));
+
+        std::vector<float> srcBatch(kBatch*N);
+        std::vector<float> dstBatch(kBatch*N);
+        std::vector<float> wBatch(GGWave::computeFFTRBatch(nullptr, nullptr, N, kBatch, nullptr));
+
+        for (int i = 0; i < N; ++i) {
+            src[i] = float(rand())/RAND_MAX - 0.5f;
+        }
+
+        for (int k = 0; k < kBatch; ++k) {
+            std::copy(src.begin(), src.end(), srcBatch.begin() + k*N);
+        }
+
+        double nsOoura = 0.0;
+        for (const auto backend : kBackends) {
+            GGWave::setFFTBackend(backend);
+
+            const auto tStart = std::chrono::steady_clock::now();
+            for (int i = 0; i < 1000*nIter; ++i) {
+                GGWave::computeFFTR(src.data(), dst.data(), N, wi.data(), wf.data());
+            }
+            const auto tEnd = std::chrono::steady_clock::now();
+
+            const double ns = std::chrono::duration<double, std::nano>(tEnd - tStart).count()/(1000*nIter);
+
+            if (backend == GGWAVE_FFT_BACKEND_OOURA) {
+                nsOoura = ns;
+                ref = dst;
+            }
+
+            float maxDiff = 0.0f;
+            for (int i = 0; i < N; ++i) {
+                maxDiff = std::max(maxDiff, std::fabs(dst[i] - ref[i]));
+            }
+
+            printf("%-6d %-8s %12.1f %12.2f %12.2e\n", N, GGWave::fftBackendName(), ns, nsOoura/ns, maxDiff);
+
+            {
+                const auto tStart = std::chrono::steady_clock::now();
+                for (int i = 0; i < 1000*nIter; i += kBatch) {
+                    GGWave::computeFFTRBatch(srcBatch.data(), dstBatch.data(), N, kBatch, wBatch.data());
+                }
+                const auto tEnd = std::chrono::steady_clock::now();
+
+                const double ns = std::chrono::duration<double, std::nano>(tEnd - tStart).count()/(1000*nIter);
+
+                float maxDiff = 0.0f;
+                for (int i = 0; i < kBatch*N; ++i) {
+                    maxDiff = std::max(maxDiff, std::fabs(dstBatch[i] - ref[i%N]));
+                }
+
+                const std::string name = std::string(GGWave::fftBackendName()) + " x" + std::to_string(kBatch);
+                printf("%-6d %-8s %12.1f %12.2f %12.2e\n", N, name.c_str(), ns, nsOoura/ns, maxDiff);
+            }
+        }
+    }
+
+    GGWave::setFFTBackend(GGWAVE_FFT_BACKEND_DEFAULT);
+
+    return 0;
+}
+
+}
+
+int main(int argc, char** argv) {
+    fprintf(stderr, "Usage: %s [-sN] [-pN] [-nN] [-rN] [-c] [-o] [-aN] [-f]\n", argv[0]);
+    fprintf(stderr, "    -sN - output sample rate, N in [%d, %d], (default: %d)\n", (int) GGWave::kSampleRateMin, (int) GGWave::kSampleRateMax, (int) GGWave::kDefaultSampleRate);
+    fprintf(stderr, "    -pN - select the transmission protocol id (default: 1)\n");
+    fprintf(stderr, "    -nN - number of encode() calls per sample format (default: 20)\n");
+    fprintf(stderr, "    -rN - resampler quality, N in [1, %d], 0 - sinc resampler (default: %d)\n", GGWave::Resampler::kMaxQuality, GGWave::kDefaultResamplerQuality);
+    fprintf(stderr, "    -c  - use the Tx symbol cache\n");
+    fprintf(stderr, "    -o  - use the oscillator-based Tx tone synthesis\n");
+    fprintf(stderr, "    -aN - benchmark the Rx analysis instead, with up to N parallel workers, N in [1, %d]\n", GGWave::kMaxAnalysisWorkers);
+    fprintf(stderr, "    -f  - benchmark the FFT backends instead\n");
+    fprintf(stderr, "\n");
+
+    const auto argm = parseCmdArguments(argc, argv);
+
+    if (argm.count("h") > 0) {
+        return 0;
+    }
+
+    const float sampleRateOut = argm.count("s") == 0 ? GGWave::kDefaultSampleRate : std::stof(argm.at("s"));
+    const int   protocolId    = argm.count("p") == 0 ?  1 : std::stoi(argm.at("p"));
+    const int   nIter         = argm.count("n") == 0 ? 20 : std::stoi(argm.at("n"));
+    const int   quality       = argm.count("r") == 0 ? GGWave::kDefaultResamplerQuality : std::stoi(argm.at("r"));
+    const bool  useCache      = argm.count("c") >  0;
+    const bool  useNCO        = argm.count("o") >  0;
+    const int   maxWorkers    = argm.count("a") == 0 ?  0 : std::stoi(argm.at("a"));
+    const bool  benchFFTs     = argm.count("f") >  0;
+
+    if (sampleRateOut < GGWave::kSampleRateMin || sampleRateOut > GGWave::kSampleRateMax) {
+        fprintf(stderr, "Invalid sample rate: %g\n", sampleRateOut);
+        return -1;
+    }
+
+    const auto & protocols = GGWave::Protocols::kDefault();
+    if (protocolId < 0 || protocolId >= (int) protocols.size() || protocols[protocolId].enabled == false) {
+        fprintf(stderr, "Invalid transmission protocol id\n");
+        return -1;
+    }
+
+    if (quality < 0 || quality > GGWave::Resampler::kMaxQuality) {
+        fprintf(stderr, "Invalid resampler quality\n");
+        return -1;
+    }
+
+    if (nIter <= 0) {
+        fprintf(stderr, "Invalid number of iterations\n");
+        return -1;
+    }
+
+    if (maxWorkers < 0 || maxWorkers > GGWave::kMaxAnalysisWorkers) {
+        fprintf(stderr, "Invalid number of analysis workers\n");
+        return -1;
+    }
+
+    if (benchFFTs) {
+        return benchFFT(nIter);
+    }
+
+    const std::string payload = "The quick brown fox jumps over the lazy dog 0123456789";
+
+    if (maxWorkers > 0) {
+        return benchAnalysis(payload, protocolId, nIter, maxWorkers);
+    }
+
+    printf("protocol: %s, sample rate: %g Hz, encode() calls: %d\n\n", protocols[protocolId].name, sampleRateOut, nIter);
+    printf("%-6s %12s %12s %16s\n", "format", "samples", "ms/encode", "samples/s");
+
+    for (const auto & format : kFormats) {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleRateOut    = sampleRateOut;
+        parameters.sampleFormatOut  = format.format;
+        parameters.operatingMode    = GGWAVE_OPERATING_MODE_TX;
+        parameters.resamplerType    = quality == 0 ? GGWAVE_RESAMPLER_SINC : GGWAVE_RESAMPLER_POLYPHASE;
+        parameters.resamplerQuality = quality;
+        if (useCache) parameters.operatingMode |= GGWAVE_OPERATING_MODE_TX_SYMBOL_CACHE;
+        if (useNCO)   parameters.operatingMode |= GGWAVE_OPERATING_MODE_TX_NCO;
+
+        GGWave ggWave(parameters);
+
+        int nSamples = 0;
+
+        const auto tStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < nIter; ++i) {
+            if (ggWave.init((int) payload.size(), payload.data(), (GGWave::TxProtocolId) protocolId, 25) == false) {
+                fprintf(stderr, "Failed to initialize the payload\n");
+                return -1;
+            }
+
+            const int nBytes = ggWave.encode();
+            if (nBytes <= 0) {
+                fprintf(stderr, "Failed to encode the payload\n");
+                return -1;
+            }
+
+            nSamples = nBytes/ggWave.sampleSizeOut();
+        }
+        const auto tEnd = std::chrono::steady_clock::now();
+
+        const double seconds = std::chrono::duration<double>(tEnd - tStart).count();
+
+        printf("%-6s %12d %12.3f %16.0f\n", format.name, nSamples, 1e3*seconds/nIter, double(nSamples)*nIter/seconds);
+    }
+
+    return 0;
+}
@@ -104,6 +104,11 @@ int main(int argc, char** argv) {
         GGWAVE_SAMPLE_FORMAT_F32,
         GGWAVE_SAMPLE_FORMAT_I16,
         mode,
+        GGWAVE_RESAMPLER_POLYPHASE,
+        GGWave::kDefaultResamplerQuality,
+        0,
+        0,
+        0,
     });
     ggWave.init(message.size(), message.data(), GGWave::TxProtocolId(protocolId), volume);
 
@@ -84,6 +84,11 @@ int main(int argc, char** argv) {
         GGWAVE_SAMPLE_FORMAT_F32,
         GGWAVE_SAMPLE_FORMAT_F32,
         mode,
+        GGWAVE_RESAMPLER_POLYPHASE,
+        GGWave::kDefaultResamplerQuality,
+        0,
+        0,
+        0,
     });
 
     printf("Available Tx protocols:\n");
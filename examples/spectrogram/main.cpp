@@ -183,23 +183,22 @@ bool GGWave_mainLoop() {
 
     static bool isInitialzed = false;
 
-    static float data[g_nSamplesPerFrame];
-    static float out [2*g_nSamplesPerFrame];
+    // the captured frames are transformed in batches
+    constexpr int kMaxFrames = 8;
 
-    static int   workI[2*g_nSamplesPerFrame];
-    static float workF[g_nSamplesPerFrame/2];
+    static float data[kMaxFrames*g_nSamplesPerFrame];
+    static float out [kMaxFrames*g_nSamplesPerFrame];
 
     static float workF0[g_nSamplesPerFrame];
     static float workF1[g_nSamplesPerFrame];
     static float workF2[11];
 
+    static std::vector<float> workFFT(GGWave::computeFFTRBatch(nullptr, nullptr, g_nSamplesPerFrame, 0, nullptr));
+
     if (!isInitialzed) {
         memset(data, 0, sizeof(data));
         memset(out,  0, sizeof(out));
 
-        memset(workI, 0, sizeof(workI));
-        memset(workF, 0, sizeof(workF));
-
         memset(workF0, 0, sizeof(workF0));
         memset(workF1, 0, sizeof(workF1));
         memset(workF2, 0, sizeof(workF2));
@@ -210,38 +209,46 @@ bool GGWave_mainLoop() {
     int n = 0;
 
     do {
-        n = SDL_DequeueAudio(g_devIdInp, data, sizeof(float)*g_nSamplesPerFrame);
-        if (n <= 0) break;
+        int nFrames = 0;
+        for (; nFrames < kMaxFrames; ++nFrames) {
+            float * frame = data + nFrames*g_nSamplesPerFrame;
 
-        if (g_filter2) {
-            GGWave::filter(GGWAVE_FILTER_FIRST_ORDER_HIGH_PASS, data, g_nSamplesPerFrame, 250.0f, GGWave::kDefaultSampleRate, workF2);
-        }
+            n = SDL_DequeueAudio(g_devIdInp, frame, sizeof(float)*g_nSamplesPerFrame);
+            if (n <= 0) break;
 
-        if (g_filter0) {
-            GGWave::filter(GGWAVE_FILTER_HANN, data, g_nSamplesPerFrame, 250.0f, GGWave::kDefaultSampleRate, workF0);
-        }
+            if (g_filter2) {
+                GGWave::filter(GGWAVE_FILTER_FIRST_ORDER_HIGH_PASS, frame, g_nSamplesPerFrame, 250.0f, GGWave::kDefaultSampleRate, workF2);
+            }
+
+            if (g_filter0) {
+                GGWave::filter(GGWAVE_FILTER_HANN, frame, g_nSamplesPerFrame, 250.0f, GGWave::kDefaultSampleRate, workF0);
+            }
 
-        if (g_filter1) {
-            GGWave::filter(GGWAVE_FILTER_HAMMING, data, g_nSamplesPerFrame, 250.0f, GGWave::kDefaultSampleRate, workF1);
+            if (g_filter1) {
+                GGWave::filter(GGWAVE_FILTER_HAMMING, frame, g_nSamplesPerFrame, 250.0f, GGWave::kDefaultSampleRate, workF1);
+            }
         }
 
-        if (GGWave::computeFFTR(data, out, g_nSamplesPerFrame, workI, workF) == false) {
+        if (nFrames == 0) break;
+
+        if (GGWave::computeFFTRBatch(data, out, g_nSamplesPerFrame, nFrames, workFFT.data()) == 0) {
             fprintf(stderr, "Failed to compute FFT!\n");
             return false;
         }
 
-        for (int i = 0; i < g_nSamplesPerFrame; ++i) {
-            out[i]  = std::sqrt(out[2*i + 0]*out[2*i + 0] + out[2*i + 1]*out[2*i + 1]);
-        }
-        for (int i = 1; i < g_nSamplesPerFrame/2; ++i) {
-            out[i]  += out[g_nSamplesPerFrame - i];
-        }
+        for (int k = 0; k < nFrames; ++k) {
+            float * spectrum = out + k*g_nSamplesPerFrame;
 
-        for (int i = 0; i < (int) g_freqData.size(); ++i) {
-            g_freqData[i].mag[g_freqDataHead] = out[i];
-        }
-        if (++g_freqDataHead == g_freqDataSize) {
-            g_freqDataHead = 0;
+            for (int i = 0; i < g_nBins; ++i) {
+                spectrum[i] = std::sqrt(spectrum[2*i + 0]*spectrum[2*i + 0] + spectrum[2*i + 1]*spectrum[2*i + 1]);
+            }
+
+            for (int i = 0; i < (int) g_freqData.size(); ++i) {
+                g_freqData[i].mag[g_freqDataHead] = spectrum[i];
+            }
+            if (++g_freqDataHead == g_freqDataSize) {
+                g_freqDataHead = 0;
+            }
         }
     } while (n > 0);
 
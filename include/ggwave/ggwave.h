@@ -86,6 +86,10 @@ extern "C" {
     //   GGWAVE_OPERATING_MODE_TX:
     //     The instance will be able generate audio waveforms for transmission
     //
+    //   GGWAVE_OPERATING_MODE_RX_AND_TX:
+    //     Both of the above. The Rx and Tx paths have separate buffers and resamplers, so the instance can keep
+    //     decoding the captured audio while it is transmitting (full duplex).
+    //
     //   GGWAVE_OPERATING_MODE_TX_ONLY_TONES:
     //     The encoding process generates only a list of tones instead of full audio
     //     waveform. This is useful for low-memory devices and embedded systems.
@@ -93,15 +97,92 @@ extern "C" {
     //   GGWAVE_OPERATING_MODE_USE_DSS:
     //     Enable the built-in Direct Sequence Spread (DSS) algorithm
     //
+    //   GGWAVE_OPERATING_MODE_TX_STREAMING:
+    //     The audio waveform is generated only incrementally via the encodeBegin() and encodeFrames() methods. The
+    //     buffers for storing the full waveform are not allocated and the encode() method cannot be used. This
+    //     significantly reduces the memory usage of Tx instances.
+    //
+    //   GGWAVE_OPERATING_MODE_TX_SYMBOL_CACHE:
+    //     Precompute the waveform of each tone for every envelope position within a Tx chunk, as well as the full
+    //     marker frames. Encoding then only sums precomputed frames. This makes repeated encoding with the same
+    //     protocol and volume much faster at the cost of additional memory (~2 MB with the default parameters).
+    //
+    //   GGWAVE_OPERATING_MODE_TX_NCO:
+    //     Synthesize the tones on the fly with recursive sine oscillators instead of precomputed sine tables. This
+    //     reduces the Tx memory by ~800 KB with the default parameters. The generated waveform matches the one
+    //     from the sine tables up to floating-point rounding.
+    //
+    //   GGWAVE_OPERATING_MODE_RX_ANALYSIS_CACHE:
+    //     Keep the spectra of the recorded frames during the analysis of variable-length payloads. When the start
+    //     offset cannot be determined from the start marker, all offsets and protocols are tried and they reuse the
+    //     same frames many times. With the cache, each frame is transformed only once. This makes the exhaustive
+    //     analysis several times faster at the cost of additional memory (~800 KB with the default parameters).
+    //
+    //   GGWAVE_OPERATING_MODE_RX_ASYNC_ANALYSIS:
+    //     Do not analyze the captured variable-length payloads inside decode(). Instead, each capture is handed to
+    //     the executor set with rxSetAnalysisExecutor() and the result is reported through the callback set with
+    //     rxSetCallback(). The recording area is double-buffered, so a new payload can be received while the
+    //     previous one is being analyzed. This doubles the memory used for the recording (~7 MB with the default
+    //     parameters).
+    //
+    //   GGWAVE_OPERATING_MODE_RX_ENERGY_GATE:
+    //     While waiting for a variable-length payload, estimate the energy in the start marker band of each enabled
+    //     protocol with a short Goertzel filter and compute the spectrum only if it rises above the noise floor of
+    //     the band. This reduces the CPU usage of idle listeners. No new spectrum is reported by rxTakeSpectrum()
+    //     for the skipped updates. Very weak transmissions close to the detection limit may be missed. See
+    //     rxListenStats().
+    //
+    //   GGWAVE_OPERATING_MODE_RX_RECORD_I16:
+    //     Store the recorded audio of variable-length payloads as 16-bit integers instead of floats. This halves
+    //     the largest Rx buffer (~3.6 MB instead of ~7.2 MB with the default parameters and protocols).
+    //
     enum {
-        GGWAVE_OPERATING_MODE_RX            = 1 << 1,
-        GGWAVE_OPERATING_MODE_TX            = 1 << 2,
-        GGWAVE_OPERATING_MODE_RX_AND_TX     = (GGWAVE_OPERATING_MODE_RX |
-                                               GGWAVE_OPERATING_MODE_TX),
-        GGWAVE_OPERATING_MODE_TX_ONLY_TONES = 1 << 3,
-        GGWAVE_OPERATING_MODE_USE_DSS       = 1 << 4,
+        GGWAVE_OPERATING_MODE_RX                = 1 << 1,
+        GGWAVE_OPERATING_MODE_TX                = 1 << 2,
+        GGWAVE_OPERATING_MODE_RX_AND_TX         = (GGWAVE_OPERATING_MODE_RX |
+                                                   GGWAVE_OPERATING_MODE_TX),
+        GGWAVE_OPERATING_MODE_TX_ONLY_TONES     = 1 << 3,
+        GGWAVE_OPERATING_MODE_USE_DSS           = 1 << 4,
+        GGWAVE_OPERATING_MODE_TX_STREAMING      = 1 << 5,
+        GGWAVE_OPERATING_MODE_TX_SYMBOL_CACHE   = 1 << 6,
+        GGWAVE_OPERATING_MODE_TX_NCO            = 1 << 7,
+        GGWAVE_OPERATING_MODE_RX_ANALYSIS_CACHE = 1 << 8,
+        GGWAVE_OPERATING_MODE_RX_ASYNC_ANALYSIS = 1 << 9,
+        GGWAVE_OPERATING_MODE_RX_ENERGY_GATE    = 1 << 10,
+        GGWAVE_OPERATING_MODE_RX_RECORD_I16     = 1 << 11,
     };
 
+    // Resampler types
+    //
+    //   GGWAVE_RESAMPLER_SINC:
+    //     Windowed-sinc interpolation that evaluates the filter for every output sample. Reference implementation
+    //
+    //   GGWAVE_RESAMPLER_POLYPHASE:
+    //     FIR filter with precomputed coefficients for a set of sub-sample phases. Ratios of small integers, such as
+    //     44100/48000, use one exact phase per output sample position. Other ratios interpolate between the phases
+    //
+    typedef enum {
+        GGWAVE_RESAMPLER_SINC,
+        GGWAVE_RESAMPLER_POLYPHASE,
+    } ggwave_ResamplerType;
+
+    // FFT backends
+    //
+    //   GGWAVE_FFT_BACKEND_DEFAULT:
+    //     GGWAVE_FFT_BACKEND_SIMD if the SIMD kernels are available, otherwise GGWAVE_FFT_BACKEND_OOURA
+    //
+    //   GGWAVE_FFT_BACKEND_OOURA:
+    //     Scalar radix-4 real FFT by Takuya Ooura. Reference implementation
+    //
+    //   GGWAVE_FFT_BACKEND_SIMD:
+    //     Radix-2 real FFT with SSE2 / AVX2 / NEON kernels, or scalar kernels if SIMD is not available
+    //
+    typedef enum {
+        GGWAVE_FFT_BACKEND_DEFAULT,
+        GGWAVE_FFT_BACKEND_OOURA,
+        GGWAVE_FFT_BACKEND_SIMD,
+    } ggwave_FFTBackend;
+
     // GGWave instance parameters
     //
     //   If payloadLength <= 0, then GGWave will transmit with variable payload length
@@ -128,16 +209,45 @@ extern "C" {
     //   example, if only Rx is enabled, then the memory buffers needed for the Tx will
     //   not be allocated.
     //
+    //   The resamplerType selects the algorithm used to convert between the sample rates.
+    //   The resamplerQuality is used only by GGWAVE_RESAMPLER_POLYPHASE and is in [1, 4].
+    //   Higher quality uses a longer filter (32*resamplerQuality taps), which improves the
+    //   stop-band attenuation at the cost of processing time and memory.
+    //   Default value: GGWAVE_RESAMPLER_POLYPHASE, GGWave::kDefaultResamplerQuality
+    //
+    //   The analysisBudget limits the work done by the analysis of a variable-length capture
+    //   in a single decode() call. It is measured in FFTs of samplesPerFrame samples. When the
+    //   budget runs out, the analysis continues in the next decode() calls and the progress is
+    //   reported by rxFramesLeftToAnalyze(). Use this to keep decode() real-time safe.
+    //   The budget is ignored with GGWAVE_OPERATING_MODE_RX_ASYNC_ANALYSIS and with analysisWorkers > 1.
+    //   Default value: 0 (no limit - the whole analysis runs in a single call)
+    //
+    //   The analysisWorkers is the number of threads that evaluate the start offset candidates of a
+    //   variable-length capture in parallel. The threads are provided by the executor set with
+    //   rxSetParallelExecutor(). The result is the same as with the sequential analysis.
+    //   Default value: 0 (sequential analysis)
+    //
+    //   The markerHop is the number of frames between two checks for a start marker while
+    //   waiting for a variable-length payload. Each check looks at the average spectrum of the
+    //   last 4 frames, so smaller values detect the start of a transmission with less delay
+    //   at the cost of more FFTs while idle. Valid values are 1, 2 and 4.
+    //   Default value: 0 (check every 4 frames)
+    //
     typedef struct {
-        int                 payloadLength;        // payload length
-        float               sampleRateInp;        // capture sample rate
-        float               sampleRateOut;        // playback sample rate
-        float               sampleRate;           // the operating sample rate
-        int                 samplesPerFrame;      // number of samples per audio frame
-        float               soundMarkerThreshold; // sound marker detection threshold
-        ggwave_SampleFormat sampleFormatInp;      // format of the captured audio samples
-        ggwave_SampleFormat sampleFormatOut;      // format of the playback audio samples
-        int                 operatingMode;        // operating mode
+        int                  payloadLength;        // payload length
+        float                sampleRateInp;        // capture sample rate
+        float                sampleRateOut;        // playback sample rate
+        float                sampleRate;           // the operating sample rate
+        int                  samplesPerFrame;      // number of samples per audio frame
+        float                soundMarkerThreshold; // sound marker detection threshold
+        ggwave_SampleFormat  sampleFormatInp;      // format of the captured audio samples
+        ggwave_SampleFormat  sampleFormatOut;      // format of the playback audio samples
+        int                  operatingMode;        // operating mode
+        ggwave_ResamplerType resamplerType;        // sample rate conversion algorithm
+        int                  resamplerQuality;     // quality of the polyphase resampler
+        int                  analysisBudget;       // max analysis work per decode() call, 0 - no limit
+        int                  analysisWorkers;      // number of parallel analysis workers, 0 or 1 - sequential
+        int                  markerHop;            // frames between the start marker checks, 0 - default
     } ggwave_Parameters;
 
     // GGWave instances are identified with an integer and are stored
@@ -236,6 +346,41 @@ extern "C" {
             void * waveformBuffer,
             int query);
 
+    // Memory-safe, single-pass variant of ggwave_encode
+    //
+    //   waveformSize - size of the waveformBuffer in bytes
+    //
+    //   returns the number of bytes written to waveformBuffer
+    //
+    //   returns -1 if there was an error
+    //
+    //   The waveform is synthesized directly into the waveformBuffer without intermediate
+    //   copies. If the return value is larger than waveformSize, then the waveformBuffer
+    //   was not big enough and nothing was written to it. In this case, the return value is
+    //   the required buffer size in bytes. Passing a NULL waveformBuffer with waveformSize
+    //   equal to 0 can be used to query the required size. For example:
+    //
+    //     char waveform[1024*1024];
+    //
+    //     int n = ggwave_nencode(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FAST, 25, waveform, sizeof(waveform));
+    //     if (n > (int) sizeof(waveform)) {
+    //         ... buffer is too small - n bytes are needed ...
+    //     }
+    //
+    //   Note that the waveform is not available through the txWaveform() method of the C++ API.
+    //   This function also works with instances created with GGWAVE_OPERATING_MODE_TX_STREAMING.
+    //
+    //   See ggwave_encode for more information
+    //
+    GGWAVE_API int ggwave_nencode(
+            ggwave_Instance instance,
+            const void * payloadBuffer,
+            int payloadSize,
+            ggwave_ProtocolId protocolId,
+            int volume,
+            void * waveformBuffer,
+            int waveformSize);
+
     // Decode an audio waveform into data
     //
     //   instance       - the GGWave instance to use
@@ -434,14 +579,70 @@ public:
     static constexpr auto kMaxLengthFixed              = 64;
     static constexpr auto kMaxSpectrumHistory          = 4;
     static constexpr auto kMaxRecordedFrames           = 2048;
+    static constexpr auto kAnalysisStepsPerFrame       = 16;
+    static constexpr auto kAnalysisCandidates          = 8;
+    static constexpr auto kAnalysisCacheFrames         = 64;
+    static constexpr auto kAnalysisRankStepsPerFFT     = 2;
+    static constexpr auto kMaxAnalysisWorkers          = 32;
+    static constexpr auto kEnergyGateWindowFraction    = 2;    // the gate looks at the last 1/2 of the average frame
+    static constexpr auto kEnergyGateThreshold         = 3.0f; // band energy relative to the noise floor
+    static constexpr auto kEnergyGateFloorRate         = 1.0f/32;
+    static constexpr auto kEnergyGateWarmup            = 8;    // measurements before the gate starts skipping updates
+    static constexpr auto kDefaultResamplerQuality     = 2;
 
     using Parameters    = ggwave_Parameters;
     using SampleFormat  = ggwave_SampleFormat;
+    using ResamplerType = ggwave_ResamplerType;
+    using FFTBackend    = ggwave_FFTBackend;
     using ProtocolId    = ggwave_ProtocolId;
     using TxProtocolId  = ggwave_ProtocolId;
     using RxProtocolId  = ggwave_ProtocolId;
     using OperatingMode = int; // ggwave_OperatingMode;
 
+    // Asynchronous analysis - see GGWAVE_OPERATING_MODE_RX_ASYNC_ANALYSIS
+    //
+    //   The executor is called from decode() when a capture is ready for analysis. It must arrange for
+    //   rxAnalyzeCapture() to be called exactly once, on any thread. Until then, the next capture is kept and is
+    //   handed to the executor by a later decode() call.
+    //
+    //   The callback is called from rxAnalyzeCapture() with the decoded payload and its protocol. If the capture
+    //   could not be decoded, the payload is nullptr and the length is -1.
+    //
+    using RxAnalysisExecutor = void (*)(GGWave * instance, void * userData);
+    using RxCallback         = void (*)(const uint8_t * payload, int length, ProtocolId protocolId, void * userData);
+
+    // Parallel analysis - see Parameters::analysisWorkers
+    //
+    //   The executor is called by the analysis with the number of workers. It must call rxAnalysisWorker(i) for each
+    //   i in [0, nWorkers), each on a different thread, and return after all of them have returned. The workers take
+    //   the candidates in the order of the sequential analysis and stop early once a candidate decodes.
+    //
+    using RxParallelExecutor = void (*)(GGWave * instance, int nWorkers, void * userData);
+
+    // Statistics for the analysis of the recorded data of variable-length payloads
+    //
+    //   Each candidate is a (protocol, start offset) pair for which the recorded data is decoded. The start offsets
+    //   with the best fitting start marker are evaluated first. If none of them decodes, all offsets are scanned.
+    //
+    struct RxAnalysisStats {
+        int nAnalyses       = 0; // number of analyzed captures
+        int nFallbacks      = 0; // number of analyses that had to scan all start offsets
+        int nCandidates     = 0; // total number of evaluated candidates
+        int nCandidatesLast = 0; // number of evaluated candidates in the last analysis
+        int nFFTs           = 0; // total number of FFTs computed by the analyses
+    };
+
+    // Statistics for listening for the start markers of variable-length payloads
+    //
+    //   While waiting for a start marker, the spectrum is computed once every markerHop frames. With
+    //   GGWAVE_OPERATING_MODE_RX_ENERGY_GATE, the spectrum updates during which the marker bands are quiet are skipped.
+    //
+    struct RxListenStats {
+        int nFrames        = 0; // number of frames processed while waiting for a start marker
+        int nSpectra       = 0; // number of computed spectra
+        int nSpectraGated  = 0; // number of spectrum updates skipped by the energy gate
+    };
+
     struct Protocol {
         const char * name;  // string identifier of the protocol
 
@@ -562,6 +763,7 @@ public:
     using AmplitudeI16 = ggvector<int16_t>;
     using Spectrum     = ggvector<float>;
     using RecordedData = ggvector<float>;
+    using RecordedI16  = ggvector<int16_t>;
     using TxRxData     = ggvector<uint8_t>;
 
     // Default constructor
@@ -634,6 +836,25 @@ public:
     //
     static void setLogFile(FILE * fptr);
 
+    // Set the FFT backend used by all GGWave instances
+    //
+    //   The tables of the FFT are computed once for each frame size and are shared by all instances.
+    //   By default, the fastest available backend is used. The instances select the transform for their
+    //   frame size in prepare() and keep it - the new backend is used by the instances created after the call.
+    //
+    //   The tables are allocated with malloc() the first time an instance or computeFFTR() uses a frame size and
+    //   they are kept until the process exits. They are not counted in heapSize(). For 1024 samples per frame,
+    //   the tables take about 16 KB, and the band transform of the SIMD backend adds about 37 KB. If the tables
+    //   cannot be allocated, prepare() fails - without the tables of the band transform, the full transform is used.
+    //   A failed allocation is not retried.
+    //
+    //   Note: not thread-safe. Do not call while any GGWave instances are running
+    //
+    static void setFFTBackend(FFTBackend backend);
+
+    // Name of the FFT kernels in use: "ooura", "scalar", "sse2", "avx2" or "neon"
+    static const char * fftBackendName();
+
     static const Parameters & getDefaultParameters();
 
     // Set Tx data to encode into sound
@@ -671,6 +892,27 @@ public:
     //
     uint32_t encode();
 
+    // Start generating the audio waveform of the Tx data incrementally
+    //
+    //   Call this method after init() and then call encodeFrames() until it returns 0. The waveform is identical to
+    //   the one produced by the encode() method. The tone frequencies are available through the txTones() method.
+    //
+    //   Returns false if the waveform cannot be generated
+    //
+    bool encodeBegin();
+
+    // Generate the next samples of the audio waveform started with encodeBegin()
+    //
+    //   dst        - buffer for the samples in the format given by sampleFormatOut()
+    //   maxSamples - maximum number of samples to write to the buffer
+    //
+    //   The waveform is synthesized one frame at a time directly into the provided buffer. Samples of a frame that do
+    //   not fit in the buffer are kept and written by the next call.
+    //
+    //   Returns the number of samples written to the buffer, 0 when the waveform is complete and -1 on error
+    //
+    int encodeFrames(void * dst, int maxSamples);
+
     // Decode an audio waveform
     //
     //   data   - pointer to the waveform data
@@ -728,6 +970,19 @@ public:
     // prepare() method, base on the contents of the global GGWave::Protocols::tx()
     const TxProtocols & txProtocols() const;
 
+    // Use the Tx tone tables of another instance
+    //
+    //   The sine tables used to synthesize the tones are computed by the first encode() call and are reused by the
+    //   following calls as long as the freqStart and bytesPerTx of the Tx protocol do not change. Instances with the
+    //   same sampleRate and samplesPerFrame can share the tables of a single instance instead of computing their own.
+    //
+    //   The other instance must outlive this one and must not be prepared again while the tables are shared.
+    //   Instances sharing tone tables must not call encode() concurrently.
+    //
+    //   Returns false if the tables of the other instance are not compatible with this instance
+    //
+    bool txShareToneTables(GGWave & other);
+
     //
     // Rx
     //
@@ -742,8 +997,33 @@ public:
     int rxFramesLeftToAnalyze() const;
     int rxDurationFrames()      const;
 
+    const RxAnalysisStats & rxAnalysisStats() const;
+    const RxListenStats &   rxListenStats()   const;
+
     bool rxStopReceiving();
 
+    // Asynchronous analysis - see GGWAVE_OPERATING_MODE_RX_ASYNC_ANALYSIS
+    //
+    //   Without an executor, the captures are analyzed right away in decode() and the callback is called from there.
+    //   The instance must not be destroyed while an analysis is in flight. init() does not interrupt the analysis, so
+    //   GGWAVE_OPERATING_MODE_RX_AND_TX instances can keep transmitting meanwhile.
+    //
+    //   rxAnalyzeCapture() returns false if there is no capture waiting for analysis.
+    //
+    void rxSetAnalysisExecutor(RxAnalysisExecutor executor, void * userData);
+    void rxSetCallback(RxCallback callback, void * userData);
+
+    bool rxAnalyzeCapture();
+    bool rxAnalysisInFlight() const;
+
+    // Parallel analysis - see Parameters::analysisWorkers
+    //
+    //   Without an executor, the workers run one after the other on the analyzing thread.
+    //
+    void rxSetParallelExecutor(RxParallelExecutor executor, void * userData);
+
+    void rxAnalysisWorker(int iWorker);
+
     // The instance will attempt to decode only these protocols.
     // They are determined upon construction or when calling the prepare() method, base on the contents of the global
     // GGWave::Protocols::rx()
@@ -769,6 +1049,8 @@ public:
 
     // Consume the received spectrum / amplitude data
     //
+    //   Only the spectrum bins used by the enabled Rx protocols are computed - the other bins are zero
+    //
     //   Returns true if there was new data available
     //
     bool rxTakeSpectrum(Spectrum & dst);
@@ -783,7 +1065,7 @@ public:
     //   src - input real-valued data, size is N
     //   dst - output complex-valued data, size is 2*N
     //
-    //   N must be == samplesPerFrame()
+    //   N must be == samplesPerFrame() and Rx must be enabled
     //
     bool computeFFTR(const float * src, float * dst, int N);
 
@@ -792,9 +1074,11 @@ public:
     //   src - input real-valued data, size is N
     //   dst - output complex-valued data, size is 2*N
     //   wi  - work buffer, with size 2*N
-    //   wf  - work buffer, with size 3 + sqrt(N/2)
+    //   wf  - work buffer, with size 3 + N/2
     //
-    //   First time calling this function, make sure that wi[0] == 0
+    //   If N is a power of 2 up to kMaxSamplesPerFrame, the shared tables of the FFT backend are used
+    //   and the work buffers are not touched. Otherwise, the Ooura FFT is used with the tables in the
+    //   work buffers - first time calling this function, make sure that wi[0] == 0
     //   This will initialize some internal coefficients and store them in wi and wf for
     //   future usage.
     //
@@ -804,6 +1088,22 @@ public:
     //
     static int computeFFTR(const float * src, float * dst, int N, int * wi, float * wf);
 
+    // Compute FFT of real values for several frames at once (static)
+    //
+    //   src   - input real-valued data, count frames of N samples - frame i starts at src + i*N
+    //   dst   - output, count frames of N values in the layout of computeFFTR() - frame i starts at dst + i*N
+    //   count - number of frames
+    //   w     - work buffer, its size depends only on N
+    //
+    //   N must be a power of 2 up to kMaxSamplesPerFrame. src == dst transforms the frames in-place.
+    //   The SIMD backends transform several frames at once, one per SIMD lane, which is faster than
+    //   calling computeFFTR() for each frame. The result for each frame is the same.
+    //
+    //   If w == nullptr - returns the needed size for w
+    //   If w != nullptr - returns 1 on success, 0 on failure
+    //
+    static int computeFFTRBatch(const float * src, float * dst, int N, int count, float * w);
+
     // Filter the waveform
     //
     //   filter   - filter to use
@@ -835,13 +1135,28 @@ public:
         // processing time is linearly related to this width
         static const int kWidth = 64;
 
+        // the polyphase filter has 32*quality taps
+        static const int kMaxQuality = 4;
+
         Resampler();
 
+        // must be called before alloc()
+        void configure(ResamplerType type, int quality);
+
         bool alloc(void * p, int & n);
 
         void reset();
 
-        int nSamplesTotal() const { return m_state.nSamplesTotal; }
+        ResamplerType type() const { return m_type; }
+
+        int64_t nSamplesTotal() const { return m_state.nSamplesTotal; }
+
+        // total number of output samples produced by resampling nSamplesInp samples with a constant factor,
+        // starting from the reset state. The split of the input into resample() calls does not matter
+        static int nSamplesOutTotal(float factor, int nSamplesInp);
+
+        // number of input samples that the next resample() call needs in order to produce nSamplesOut samples
+        int nSamplesInpNeeded(float factor, int nSamplesOut) const;
 
         int resample(
                 float factor,
@@ -850,9 +1165,19 @@ public:
                 float * samplesOut);
 
     private:
+        // if factor is a ratio p/q of small integers, the output sample times are tracked exactly as k*p/q
+        static bool getRatio(float factor, int & p, int & q);
+
+        // move to the time of the next output sample
+        void advance();
+
+        float interpolateSinc(float factor) const;
+        float interpolatePolyphase() const;
+
         float getData(int j) const;
         void newData(float data);
         void makeSinc();
+        void makePolyphase(float factor);
         double sinc(double x) const;
 
         static const int kDelaySize = 140;
@@ -860,16 +1185,40 @@ public:
         // this defines how finely the sinc function is sampled for storage in the table
         static const int kSamplesPerZeroCrossing = 32;
 
+        // number of polyphase filter phases for ratios that are not ratios of small integers
+        static const int kPhases = 256;
+
+        // the polyphase resampler keeps the last kHistorySize input samples in a mirrored circular buffer and
+        // delays the output by kLatency input samples - same as the sinc resampler
+        static const int kHistorySize = 256;
+        static const int kLatency     = 2*kWidth + 8;
+
+        ResamplerType m_type = GGWAVE_RESAMPLER_SINC;
+
+        int   m_width        = kWidth; // half-width of the polyphase filter
+        float m_phasesFactor = 0.0f;   // the factor for which m_phases is computed
+
         ggvector<float> m_sincTable;
         ggvector<float> m_delayBuffer;
         ggvector<float> m_edgeSamples;
         ggvector<float> m_samplesInp;
 
+        ggvector<float> m_phases;  // [phase][tap]
+        ggvector<float> m_history;
+
+        // the sample counters are 64-bit so that a continuously running resampler never has to be reset
         struct State {
-            int nSamplesTotal = 0;
-            int timeInt       = 0;
-            int timeLast      = 0;
-            double timeNow    = 0.0;
+            int64_t nSamplesTotal = 0;
+            int64_t nSamplesOut   = 0;
+            int64_t timeInt       = 0;
+            int64_t timeLast      = 0;
+            int     timeNum       = 0; // numerator of the fractional part of the time when q > 0
+            double  timeNow       = 0.0;
+            float   factor        = 0.0f;
+
+            // factor == p/q
+            int p = 0;
+            int q = 0;
         };
 
         State m_state;
@@ -881,14 +1230,127 @@ private:
     void decode_fixed();
     void decode_variable();
 
+    // rank the start offsets of the recorded data by how well the start marker ends right before them
+    //   returns the number of offsets written to "offsets" or -1 if the analysis budget ran out
+    //   the ranking resumes from where it stopped on the next call
+    int rankOffsets(const RxProtocol & protocol, int * offsets, int nOffsetsMax);
+
+    enum AnalysisResult {
+        kAnalysisFailed,
+        kAnalysisDecoded,
+        kAnalysisPending,
+    };
+
+    // try to decode the recorded data, starting at the given offset (in steps), with the buffers of the given worker
+    //   useCache - sum the cached spectra of the frames instead of transforming each chunk
+    //   returns kAnalysisPending if the analysis budget ran out - call again with the same arguments to resume
+    AnalysisResult decodeOffset(int iWorker, int protocolId, int offsetStart, bool useCache);
+
+    // run the analysis of the recorded data until it finishes or the analysis budget runs out
+    //   returns false if the analysis is not finished yet
+    bool analyze();
+
+    // evaluate all candidates with the parallel workers
+    //   returns true if a candidate decoded - the result is in the buffers of the first worker
+    bool analyzeParallel();
+
+    // hand the completed recording to the analysis executor and start recording in the other buffer
+    //   returns false if the previous capture is still being analyzed
+    bool handOffCapture();
+
+    // transform the recorded frames offset + k*kAnalysisStepsPerFrame, 0 <= k < count, that are not in the cache
+    void analysisCacheFill(int offset, int count);
+
+    // complex spectrum of the data bins of the recorded frame starting at the given offset (in steps) - see analysisCacheFill()
+    const float * analysisFrameSpectrum(int offset);
+
     int maxFramesPerTx(const Protocols & protocols, bool excludeMT) const;
     int minBytesPerTx(const Protocols & protocols) const;
+    int maxRecvDurationFrames(const Protocols & protocols) const;
     int maxBytesPerTx(const Protocols & protocols) const;
     int maxTonesPerTx(const Protocols & protocols) const;
     int minFreqStart(const Protocols & protocols) const;
+    int maxFreqEnd(const Protocols & protocols) const;
+    int maxEnvelopeClasses(const Protocols & protocols) const;
 
     double bitFreq(const Protocol & p, int bit) const;
 
+    // spectrum bins of the marker bits of an Rx protocol - recomputed only when the protocol's freqStart changes
+    const int * markerBins(int protocolId);
+
+    // spectrum bins [bin0, bin1) read by the enabled Rx protocols - the other bins of the spectrum are kept at zero
+    void spectrumBand(int & bin0, int & bin1);
+
+    // check if there is energy above the noise floor in the start marker band of any of the enabled Rx protocols
+    bool energyGateOpen();
+
+    // tone votes of the fixed-length decoding
+    //   the votes of each Tx are updated incrementally - the newest frame is added and the frames that move
+    //   to the previous Tx or out of the window are retired. The votes are rebuilt from the spectrum history
+    //   when the parameters of the protocol change
+    void votesFixedTones(int protocolId, int historyId);
+    void votesFixedAdd(int protocolId, int tx, int historyId, int delta);
+    void votesFixedRebuild(int protocolId);
+    void votesFixedUpdate(int protocolId);
+
+    // access to the recorded audio of the analysis - the samples are converted to float if stored as int16
+    //   copy / add samplesPerFrame samples starting at the given sample offset
+    void recordedCopy(int offset, float * dst) const;
+    void recordedAdd(int offset, float * dst) const;
+
+    // Sine tables for synthesizing the Tx tones
+    //
+    //   The contents depend only on the key values below, so the tables are recomputed only when the key changes
+    //
+    struct ToneTables {
+        int16_t freqStart       = -1;
+        int8_t  bytesPerTx      = -1;
+        float   sampleRate      = -1.0f;
+        int     samplesPerFrame = -1;
+
+        ggvector<double> phaseOffsets;
+
+        AmplitudeArr bit1Amplitude;
+        AmplitudeArr bit0Amplitude;
+
+        // recursive oscillators for each tone, see GGWAVE_OPERATING_MODE_TX_NCO
+        ggvector<double> oscCoeff; // 2*cos(kOscLanes*w)
+        ggvector<double> oscInit;  // sin(phase + j*w), j = -kOscLanes .. kOscLanes - 1
+    };
+
+    static constexpr int kOscLanes = 4;
+
+    // Precomputed enveloped and volume-scaled Tx frames
+    //
+    //   Frames within a Tx chunk that are not affected by the envelope ramps share the same envelope class.
+    //   The marker frames are stored fully synthesized, including the 1/nFreq scaling.
+    //
+    struct ToneSymbols {
+        int16_t freqStart   = -1;
+        int8_t  framesPerTx = -1;
+        int8_t  bytesPerTx  = -1;
+        float   volume      = -1.0f;
+
+        int nTones = 0; // rows per envelope class
+
+        ggvector<int> envelopeClass; // envelope class of each frame in a Tx chunk
+        AmplitudeArr  tones;         // [class*nTones + tone][sample]
+        AmplitudeArr  markers;       // [frame][sample] - start marker frames, followed by the end marker frames
+    };
+
+    ToneTables & txToneTables();
+    void txUpdateToneTables();
+
+    // waveform of a single frame of tone k
+    Amplitude txTone(int k);
+    void txUpdateToneSymbols();
+
+    // amplitude envelope of frame cycleMod out of nPerCycle
+    const float * txEnvelope(int cycleMod, int nPerCycle);
+
+    int  encodeFrame();
+    void encodeConvert(const float * src, void * dst, int n, SampleFormat format) const;
+
     // Initialized via prepare()
     float        m_sampleRateInp        = -1.0f;
     float        m_sampleRateOut        = -1.0f;
@@ -917,12 +1379,40 @@ private:
 
     bool         m_isRxEnabled          = false;
     bool         m_isTxEnabled          = false;
-    bool         m_needResampling       = false;
+    bool         m_needResamplingInp    = false;
+    bool         m_needResamplingOut    = false;
     bool         m_txOnlyTones          = false;
     bool         m_isDSSEnabled         = false;
+    bool         m_txStreaming          = false;
+    bool         m_txSymbolCache        = false;
+    bool         m_txNCO                = false;
+    bool         m_rxAnalysisCache      = false;
+    bool         m_rxAsyncAnalysis      = false;
+    bool         m_rxEnergyGate         = false;
+    bool         m_rxRecordI16          = false;
+    int          m_rxAnalysisBudget     = 0;
+    int          m_rxAnalysisWorkers    = 1;
+    int          m_rxMarkerHop          = kMaxSpectrumHistory;
+
+    RxAnalysisExecutor m_rxExecutor                 = nullptr;
+    void *             m_rxExecutorUserData         = nullptr;
+    RxCallback         m_rxCallback                 = nullptr;
+    void *             m_rxCallbackUserData         = nullptr;
+    RxParallelExecutor m_rxParallelExecutor         = nullptr;
+    void *             m_rxParallelExecutorUserData = nullptr;
+
+    // in-place real FFT of samplesPerFrame samples, selected in prepare() - Rx only
+    void (*m_fft)(float * a) = nullptr;
+
+    // real FFT of a batch of frames, nullptr if the backend transforms one frame at a time
+    void (*m_fftBatch)(const float * src, float * dst, int count, float * work) = nullptr;
+    int m_fftBatchFrames = 1; // frames per batch
+
+    // the bins [bin0, bin1) of the real FFT, nullptr if the backend has only the full transform
+    //   used for the spectrum of each Rx frame while the band of the enabled Rx protocols is narrow enough
+    void (*m_fftBand)(const float * src, float * dst, int bin0, int bin1, float * work) = nullptr;
 
     // Common
-    TxRxData m_dataEncoded;
     TxRxData m_workRSLength; // Reed-Solomon work buffers
     TxRxData m_workRSData;
 
@@ -935,7 +1425,8 @@ private:
         int nMarkersSuccess     = 0;
         int markerFreqStart     = 0;
         int recvDuration_frames = 0;
-        int minFreqStart        = 0;
+        int spectrumBin0        = 0;
+        int spectrumBin1        = 0;
 
         int framesLeftToAnalyze = 0;
         int framesLeftToRecord  = 0;
@@ -944,18 +1435,22 @@ private:
         int samplesNeeded       = 0;
 
         ggvector<float> fftOut; // complex
-        ggvector<int>   fftWorkI;
-        ggvector<float> fftWorkF;
+        ggvector<float> fftWork; // work buffer of the band transform, used only with m_fftBand
 
         bool hasNewRxData    = false;
         bool hasNewSpectrum  = false;
         bool hasNewAmplitude = false;
 
         Spectrum  spectrum;
-        Amplitude amplitude;
+        Amplitude amplitude;       // the current frame - a view of amplitudeBuffer or, while recording, of its slot in the recording
+        Amplitude amplitudeBuffer;
         Amplitude amplitudeResampled;
         TxRxData  amplitudeTmp;
 
+        Resampler resampler; // sampleRateInp -> sampleRate
+
+        TxRxData dataEncoded;
+
         int dataLength = 0;
 
         TxRxData     data;
@@ -964,18 +1459,115 @@ private:
         RxProtocols  protocols;
 
         // variable-length decoding
-        int historyId = 0;
+        int  historyId         = 0;
+        bool amplitudeSumValid = false;
 
         Amplitude    amplitudeAverage;
+        Amplitude    amplitudeSum;      // sum of amplitudeHistory, see amplitudeSumValid
         AmplitudeArr amplitudeHistory;
         RecordedData amplitudeRecorded;
+        RecordedI16  amplitudeRecordedI16; // used instead of amplitudeRecorded with GGWAVE_OPERATING_MODE_RX_RECORD_I16
+
+        int recordedFrames = 0; // capacity of the recording, fits the longest payload of the Rx protocols at prepare()
+
+        ggvector<double> markerDFT;   // sliding DFT of the marker bins
+        ggvector<float>  markerScore; // [offset]
+
+        ggvector<int> markerBins;          // [protocol][bit] - spectrum bin of each marker bit
+        ggvector<int> markerBinsFreqStart; // [protocol] - freqStart for which the marker bins were computed, -1 if none
+
+        // used only with GGWAVE_OPERATING_MODE_RX_ENERGY_GATE
+        ggvector<float> energyGateFloor;    // [protocol] - noise floor of the marker band
+        ggvector<int>   energyGateMeasured; // [protocol] - number of measurements of the noise floor
+
+        RxListenStats listenStats;
+
+        // used only with GGWAVE_OPERATING_MODE_RX_ANALYSIS_CACHE
+        int analysisCacheBin0  = 0; // first cached bin
+        int analysisCacheNBins = 0;
+
+        ggvector<int>   analysisCacheOffsets; // [slot] - offset of the cached frame, -1 if empty
+        ggmatrix<float> analysisCacheSpectra; // [slot][2*bin] - complex
+        ggvector<float> analysisCacheWork; // m_fftBatchFrames frames
+
+        RxAnalysisStats analysisStats;
+
+        // buffers and state for decoding a single candidate
+        struct AnalysisWorker {
+            int  itx           = 0;
+            bool knownLength   = false;
+            int  decodedLength = 0;
+
+            // the Txs itx0 .. itx0 + nTxs - 1 are transformed in fftBatch
+            int itx0 = 0;
+            int nTxs = 0;
+
+            int nFFTs            = 0;  // not yet added to the analysis stats
+            int nCandidates      = 0;  // evaluated by this worker in the parallel analysis
+            int decodedCandidate = -1; // decoded by this worker in the parallel analysis
+
+            // the buffers of the first worker alias the decoding buffers, unless the analysis is asynchronous
+            ggvector<float> fftOut; // complex
+            ggvector<float> fftBatch; // m_fftBatchFrames frames - aliases fftOut if the frames are transformed one at a time
+            ggvector<float> fftWork;  // work buffer of the batch, used only with m_fftBatch
+            Spectrum        spectrum;
+            TxRxData        dataEncoded;
+            TxRxData        data;
+            TxRxData        workRSLength;
+            TxRxData        workRSData;
+        };
+
+        // state of an analysis that is spread across multiple decode() calls or runs on the executor
+        struct Analysis {
+            bool started = false;
+
+            int budgetLeft = 0; // remaining analysis work in the current decode() call
+
+            // the capture that is being analyzed
+            int markerFreqStart     = 0;
+            int recvDuration_frames = 0;
+
+            int pass       = 0;
+            int protocolId = 0;
+            int candidate  = 0;  // next candidate of the current protocol
+            int rankStep   = 0;  // next step of the offset ranking
+            int nRanked    = -1; // -1 - the offsets are not ranked yet
+
+            int offsets[kAnalysisCandidates];
+
+            // the recording aliases the decoding one, unless the analysis is asynchronous
+            RecordedData amplitudeRecorded;
+            RecordedI16  amplitudeRecordedI16;
+
+            // used only with analysisWorkers > 1
+            long nextCandidate = 0; // accessed atomically - next candidate to evaluate
+            long bestCandidate = 0; // accessed atomically - first candidate that decoded
+            int  nCandidates   = 0;
+            int  nCandidates0  = 0; // number of candidates in the first pass
+
+            ggvector<int> candidates; // [i] - protocolId*nOffsets + offset, in the order of the sequential analysis
+
+            // the first worker is used by the sequential analysis
+            AnalysisWorker workers[kMaxAnalysisWorkers];
+        } analysis;
+
+        // used only with GGWAVE_OPERATING_MODE_RX_ASYNC_ANALYSIS
+        bool captureReady      = false; // the recording is complete, but not handed to the executor yet
+        long analysisInFlight  = 0;     // accessed atomically - 1 from the hand-off until the callback returns
 
         // fixed-length decoding
         int historyIdFixed = 0;
 
         ggmatrix<uint8_t> spectrumHistoryFixed;
-        ggvector<uint8_t> detectedBins;
-        ggvector<uint8_t> detectedTones;
+
+        int nTonesFixed = 0; // max number of tones per Tx
+        int nTxsFixed   = 0; // max number of Txs of a payload
+
+        ggmatrix<uint8_t>  tonesFixed;         // [frame][protocol*nTonesFixed + tone] - the strongest of the 16 bins of each tone
+        ggmatrix<uint8_t>  votesFixed;         // [protocol][(tx*nTonesFixed + tone)*16 + bin] - number of frames of the Tx in which the bin is the strongest
+        ggmatrix<int8_t>   majorityFixed;      // [protocol][tx*nTonesFixed + tone] - the bin with more than framesPerTx/2 votes, -1 if none
+        ggvector<int>      detectedFixed;      // [protocol] - number of tones of the payload with a majority
+        ggvector<Protocol> votesFixedProtocol; // [protocol] - parameters for which the votes are accumulated, not enabled if none
     } m_rx;
 
     struct Tx {
@@ -986,27 +1578,41 @@ private:
         int dataLength = 0;
         int lastAmplitudeSize = 0;
 
+        // incremental encoding
+        bool encoding = false;
+
+        int frameId         = 0;
+        int totalDataFrames = 0;
+        int samplesPending  = 0; // samples of the last frame in outputResampled that are not yet written
+        int samplesOffset   = 0;
+
         ggvector<bool> dataBits;
-        ggvector<double> phaseOffsets;
 
-        AmplitudeArr bit1Amplitude;
-        AmplitudeArr bit0Amplitude;
+        ToneTables   toneTables;
+        ToneTables * toneTablesShared = nullptr; // see txShareToneTables()
+
+        ToneSymbols toneSymbols;
 
         TxRxData    data;
+        TxRxData    dataEncoded;
         TxProtocol  protocol;
         TxProtocols protocols;
 
+        Amplitude    tone; // used only with GGWAVE_OPERATING_MODE_TX_NCO
+        Amplitude    envelope;
+        int          envelopeCycleMod  = -1;
+        int          envelopeNPerCycle = -1;
         Amplitude    output;
         Amplitude    outputResampled;
         TxRxData     outputTmp;
         AmplitudeI16 outputI16;
 
+        Resampler resampler; // sampleRate -> sampleRateOut
+
         int nTones = 0;
         Tones tones;
     } m_tx;
 
-    mutable Resampler m_resampler;
-
     void * m_heap  = nullptr;
     int m_heapSize = 0;
 };
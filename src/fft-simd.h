@@ -0,0 +1,1542 @@
+#pragma once
+
+/*
+
+Real FFT backends
+
+Both backends compute the real FFT in-place, with the output layout of the Ooura rdft(n, 1, ...):
+
+    a[2*k]     = R[k], 0 <= k < n/2
+    a[2*k + 1] = I[k], 0 <  k < n/2
+    a[1]       = R[n/2]
+
+    ooura   : the scalar radix-4 FFT from fft.h - reference implementation
+    simd    : radix-2 complex FFT of the n/2 even / odd sample pairs, followed by a split into the real spectrum
+              SSE2 and AVX2 on x86 (AVX2 is selected at runtime if the CPU supports it), NEON on ARM, scalar otherwise
+
+The tables of both backends are computed once per size and are shared by all instances. A plan is created on the
+first request for its size - the GGWave instances request it in prepare(). The plans are never freed.
+
+The SIMD backends also transform batches of frames, one frame per SIMD lane (see rdftLanes()) - 8 frames with AVX2,
+4 with SSE2 and NEON. A frame gets the same result in a batch as alone.
+
+The SIMD backends also compute only a band of bins of a frame (see bandLanes()), for the receivers that listen to a
+few protocols. The band matches the full transform up to rounding.
+
+The kernels take the size of the complex FFT as a template argument M - with M == 0, it is read from the plan. For
+the usual frame sizes 128 .. 1024, each backend has a transform with all loop bounds and strides known at compile
+time (see transform()), so that the transform of an instance is selected once in prepare().
+
+Define GGWAVE_DISABLE_SIMD to use the scalar kernels. In that case, the Ooura FFT is the default backend.
+
+*/
+
+#include "fft.h"
+#include "simd.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace fft {
+
+// the largest size with a plan - the same as GGWave::kMaxSamplesPerFrame
+constexpr int kMaxLog2 = 10;
+
+// the smallest size with a transform specialized at compile time
+constexpr int kMinLog2Fixed = 7;
+
+// the most frames transformed at once by a batch
+constexpr int kMaxLanes = 8;
+
+constexpr int log2i(int n) {
+    return n > 1 ? 1 + log2i(n/2) : 0;
+}
+
+// the alignment of the work buffers of the batches and the band transforms, in bytes
+constexpr int kWorkAlignment = 32;
+
+// the work buffer of a batch of frames of n samples, in floats - see TransformBatch
+//   the kernels align it to kWorkAlignment, so it can start at any float
+inline int batchWorkSize(int n) {
+    return kMaxLanes*n + kWorkAlignment/sizeof(float);
+}
+
+// the work buffer of a band transform of n samples, in floats - see TransformBand
+inline int bandWorkSize(int n) {
+    return n + kWorkAlignment/sizeof(float);
+}
+
+inline float * alignWork(float * work) {
+    return (float *) (((uintptr_t) work + kWorkAlignment - 1) & ~(uintptr_t) (kWorkAlignment - 1));
+}
+
+// number of swaps of the bit-reversal permutation of m elements - the indices that are their own reverse stay
+constexpr int numSwaps(int m) {
+    return (m - (1 << ((log2i(m) + 1)/2)))/2;
+}
+
+struct Plan {
+    int n = 0; // number of real samples
+    int m = 0; // n/2 - size of the complex FFT
+
+    // bit-reversal permutation of the complex samples - pairs of indices to swap
+    int        nSwaps = 0;
+    uint16_t * swaps  = nullptr;
+
+    // bit-reversed index of each complex sample - the batches permute the samples while transposing them
+    uint16_t * rev = nullptr;
+
+    // twiddles of the radix-2 stage with half-size h start at 2*(h - 1):
+    //   twr - [cos, cos] of each twiddle
+    //   twi - [sin, -sin] of each twiddle, so that x*w = x*twr + swap(x)*twi
+    float * twr = nullptr;
+    float * twi = nullptr;
+
+    // twiddles of the split into the real spectrum, for 0 < k < m/2 at 2*k - same layout as above
+    float * postr = nullptr;
+    float * posti = nullptr;
+
+    // Ooura tables - read-only after the plan is created
+    int   * ip = nullptr;
+    float * w  = nullptr;
+};
+
+inline void freePlan(Plan & plan) {
+    free(plan.swaps);
+    free(plan.rev);
+    free(plan.twr);
+    free(plan.twi);
+    free(plan.postr);
+    free(plan.posti);
+    free(plan.ip);
+    free(plan.w);
+
+    plan = Plan();
+}
+
+// the plan for n real samples - plan.n is 0 if the tables cannot be allocated
+inline Plan makePlan(int n) {
+    const double kPi = 3.14159265358979323846;
+
+    const int m = n/2;
+
+    Plan plan;
+    plan.swaps = (uint16_t *) malloc(sizeof(uint16_t)*(m + 1));
+    plan.rev   = (uint16_t *) malloc(sizeof(uint16_t)*m);
+    plan.twr   = (float *) malloc(sizeof(float)*2*m);
+    plan.twi   = (float *) malloc(sizeof(float)*2*m);
+    plan.postr = (float *) malloc(sizeof(float)*(m + 2));
+    plan.posti = (float *) malloc(sizeof(float)*(m + 2));
+    plan.ip    = (int *) calloc(3 + (int) sqrt(n/2.0), sizeof(int));
+    plan.w     = (float *) calloc(n/2 + 1, sizeof(float));
+
+    float * tmp = (float *) calloc(n, sizeof(float));
+
+    if (plan.swaps == nullptr || plan.rev   == nullptr || plan.twr == nullptr || plan.twi == nullptr ||
+        plan.postr == nullptr || plan.posti == nullptr || plan.ip  == nullptr || plan.w   == nullptr || tmp == nullptr) {
+        freePlan(plan);
+        free(tmp);
+        return plan;
+    }
+
+    plan.n = n;
+    plan.m = m;
+
+    int log2m = 0;
+    while ((1 << log2m) < m) {
+        ++log2m;
+    }
+
+    for (int i = 0; i < m; ++i) {
+        int r = 0;
+        for (int b = 0; b < log2m; ++b) {
+            r |= ((i >> b) & 1) << (log2m - 1 - b);
+        }
+        plan.rev[i] = r;
+        if (i < r) {
+            plan.swaps[2*plan.nSwaps + 0] = i;
+            plan.swaps[2*plan.nSwaps + 1] = r;
+            ++plan.nSwaps;
+        }
+    }
+
+    for (int h = 1; h < m; h *= 2) {
+        for (int j = 0; j < h; ++j) {
+            // the quarter turn is exact, so that the kernels with unrolled trivial twiddles give the same result
+            const double c = 2*j == h ?  0.0 :  cos((kPi*j)/h);
+            const double s = 2*j == h ? -1.0 : -sin((kPi*j)/h);
+            plan.twr[2*(h - 1) + 2*j + 0] =  c;
+            plan.twr[2*(h - 1) + 2*j + 1] =  c;
+            plan.twi[2*(h - 1) + 2*j + 0] = -s;
+            plan.twi[2*(h - 1) + 2*j + 1] =  s;
+        }
+    }
+
+    for (int k = 0; k < m/2; ++k) {
+        const double c = cos((2.0*kPi*k)/n);
+        const double s = sin((2.0*kPi*k)/n);
+        plan.postr[2*k + 0] =  c;
+        plan.postr[2*k + 1] =  c;
+        plan.posti[2*k + 0] =  s;
+        plan.posti[2*k + 1] = -s;
+    }
+
+    // the Ooura tables are initialized by the first transform
+    rdft(n, 1, tmp, plan.ip, plan.w);
+    free(tmp);
+
+    return plan;
+}
+
+template <int K>
+inline const Plan & planLog2() {
+    static const Plan res = makePlan(1 << K);
+    return res;
+}
+
+inline const Plan * validPlan(const Plan & plan) {
+    return plan.n > 0 ? &plan : nullptr;
+}
+
+// the plan for n real samples, nullptr if n is not a power of 2 in [2, 2^kMaxLog2] or if its tables could not be allocated
+inline const Plan * plan(int n) {
+    switch (n) {
+        case    2: return validPlan(planLog2<1>());
+        case    4: return validPlan(planLog2<2>());
+        case    8: return validPlan(planLog2<3>());
+        case   16: return validPlan(planLog2<4>());
+        case   32: return validPlan(planLog2<5>());
+        case   64: return validPlan(planLog2<6>());
+        case  128: return validPlan(planLog2<7>());
+        case  256: return validPlan(planLog2<8>());
+        case  512: return validPlan(planLog2<9>());
+        case 1024: return validPlan(planLog2<10>());
+    };
+
+    return nullptr;
+}
+
+//
+// scalar
+//
+
+template <int M = 0>
+inline void bitReverse(const Plan & plan, float * a) {
+    const int nSwaps = M > 0 ? numSwaps(M) : plan.nSwaps;
+
+    for (int i = 0; i < nSwaps; ++i) {
+        float * x = a + 2*plan.swaps[2*i + 0];
+        float * y = a + 2*plan.swaps[2*i + 1];
+
+        const float x0 = x[0];
+        const float x1 = x[1];
+        x[0] = y[0];
+        x[1] = y[1];
+        y[0] = x0;
+        y[1] = x1;
+    }
+}
+
+// radix-2 butterflies of the stage with half-size h - H > 0 fixes h at compile time
+template <int M = 0, int H = 0>
+inline void stage_scalar(const Plan & plan, float * a, int hp = H) {
+    const int m = M > 0 ? M : plan.m;
+    const int h = H > 0 ? H : hp;
+
+    const float * twr = plan.twr + 2*(h - 1);
+    const float * twi = plan.twi + 2*(h - 1);
+
+    for (int k = 0; k < m; k += 2*h) {
+        for (int j = 0; j < h; ++j) {
+            float * u = a + 2*(k + j);
+            float * v = a + 2*(k + j + h);
+
+            const float tr = v[0]*twr[2*j + 0] + v[1]*twi[2*j + 0];
+            const float ti = v[1]*twr[2*j + 1] + v[0]*twi[2*j + 1];
+
+            v[0] = u[0] - tr;
+            v[1] = u[1] - ti;
+            u[0] = u[0] + tr;
+            u[1] = u[1] + ti;
+        }
+    }
+}
+
+// the first stage has only trivial twiddles
+template <int M = 0>
+inline void stage1_scalar(const Plan & plan, float * a) {
+    const int m = M > 0 ? M : plan.m;
+
+    for (int k = 0; k < m; k += 2) {
+        float * u = a + 2*k;
+        float * v = a + 2*k + 2;
+
+        const float ur = u[0];
+        const float ui = u[1];
+
+        u[0] = ur + v[0];
+        u[1] = ui + v[1];
+        v[0] = ur - v[0];
+        v[1] = ui - v[1];
+    }
+}
+
+// the second stage, with the twiddles 1 and -i
+template <int M = 0>
+inline void stage2_scalar(const Plan & plan, float * a) {
+    const int m = M > 0 ? M : plan.m;
+
+    for (int k = 0; k < m; k += 4) {
+        float * u0 = a + 2*k;
+        float * u1 = a + 2*k + 2;
+        float * v0 = a + 2*k + 4;
+        float * v1 = a + 2*k + 6;
+
+        const float tr0 = v0[0];
+        const float ti0 = v0[1];
+        const float tr1 = v1[1];
+        const float ti1 = -v1[0];
+
+        v0[0] = u0[0] - tr0;
+        v0[1] = u0[1] - ti0;
+        u0[0] = u0[0] + tr0;
+        u0[1] = u0[1] + ti0;
+
+        v1[0] = u1[0] - tr1;
+        v1[1] = u1[1] - ti1;
+        u1[0] = u1[0] + tr1;
+        u1[1] = u1[1] + ti1;
+    }
+}
+
+// split the complex FFT of the even / odd sample pairs into the spectrum of the real samples, for k0 <= k < k1
+template <int M = 0>
+inline void post_scalar(const Plan & plan, float * a, int k0, int k1) {
+    const int m = M > 0 ? M : plan.m;
+
+    for (int k = k0; k < k1; ++k) {
+        float * x = a + 2*k;
+        float * y = a + 2*(m - k);
+
+        const float sr = x[0] + y[0];
+        const float si = x[1] + y[1];
+        const float dr = x[0] - y[0];
+        const float di = x[1] - y[1];
+
+        const float hr = sr*0.5f;
+        const float hi = di*0.5f;
+        const float gr = si*0.5f;
+        const float gi = dr*(-0.5f);
+
+        const float tr = gr*plan.postr[2*k + 0] + gi*plan.posti[2*k + 0];
+        const float ti = gi*plan.postr[2*k + 1] + gr*plan.posti[2*k + 1];
+
+        x[0] =   hr + tr;
+        x[1] = -(hi + ti);
+        y[0] =   hr - tr;
+        y[1] =   hi - ti;
+    }
+}
+
+// the DC and Nyquist bins - the bin m/2 of the complex FFT is already in place
+inline void postDC(float * a) {
+    const float r = a[0];
+    const float i = a[1];
+
+    a[0] = r + i;
+    a[1] = r - i;
+}
+
+inline void rdft_scalar(const Plan & plan, float * a) {
+    if (plan.m > 1) {
+        bitReverse(plan, a);
+        stage1_scalar(plan, a);
+        if (plan.m > 2) {
+            stage2_scalar(plan, a);
+        }
+        for (int h = 4; h < plan.m; h *= 2) {
+            stage_scalar(plan, a, h);
+        }
+        post_scalar(plan, a, 1, plan.m/2);
+    }
+
+    postDC(a);
+}
+
+// the stages with half-size H, 2*H, ... < M
+template <int M, int H, bool = (H < M)>
+struct Stages_scalar {
+    static void run(const Plan & plan, float * a) {
+        stage_scalar<M, H>(plan, a);
+        Stages_scalar<M, 2*H>::run(plan, a);
+    }
+};
+
+template <int M, int H>
+struct Stages_scalar<M, H, false> {
+    static void run(const Plan & , float * ) {}
+};
+
+template <int K>
+struct Fixed_scalar {
+    static constexpr int M = (1 << K)/2;
+
+    static void rdft(float * a) {
+        const Plan & plan = planLog2<K>();
+
+        bitReverse<M>(plan, a);
+        stage1_scalar<M>(plan, a);
+        stage2_scalar<M>(plan, a);
+        Stages_scalar<M, 4>::run(plan, a);
+        post_scalar<M>(plan, a, 1, M/2);
+        postDC(a);
+    }
+};
+
+#if defined(GGWAVE_SIMD_X86) || defined(GGWAVE_SIMD_NEON)
+
+//
+// batches
+//
+// A batch transforms L frames at once, one frame per SIMD lane. The frames are transposed into a work buffer in which
+// each vector holds the same sample of all L frames, so that the butterflies are the scalar ones applied to vectors,
+// without the shuffles of the single-frame kernels. The transpose into the work buffer also does the bit reversal.
+// The work buffer is provided by the caller (see batchWorkSize()), so that the kernels use little stack.
+//
+
+// the smallest size transformed in batches
+constexpr int kMinLog2Batch = 4;
+
+typedef float f32x4 __attribute__((vector_size(16)));
+typedef float f32x8 __attribute__((vector_size(32)));
+
+// the complex sample j of all lanes is at x[2*j] (real) and x[2*j + 1] (imaginary), in bit-reversed order
+//   the butterflies and the twiddles are those of rdft_scalar(), so each lane gets the result of a single transform
+template <typename V>
+__attribute__((always_inline))
+inline void rdftLanes(const Plan & plan, V * x) {
+    const int m = plan.m;
+
+    // pairs of stages h and 2*h
+    int h = 1;
+    for (; 2*h < m; h *= 4) {
+        const float * twr0 = plan.twr + 2*(h - 1);
+        const float * twi0 = plan.twi + 2*(h - 1);
+        const float * twr1 = plan.twr + 2*(2*h - 1);
+        const float * twi1 = plan.twi + 2*(2*h - 1);
+
+        for (int k = 0; k < m; k += 4*h) {
+            for (int j = 0; j < h; ++j) {
+                V * x0 = x + 2*(k + j);
+                V * x1 = x0 + 2*h;
+                V * x2 = x1 + 2*h;
+                V * x3 = x2 + 2*h;
+
+                V a0r = x0[0], a0i = x0[1];
+                V a1r = x1[0], a1i = x1[1];
+                V a2r = x2[0], a2i = x2[1];
+                V a3r = x3[0], a3i = x3[1];
+
+                V tr = a1r*twr0[2*j + 0] + a1i*twi0[2*j + 0];
+                V ti = a1i*twr0[2*j + 1] + a1r*twi0[2*j + 1];
+                a1r = a0r - tr; a1i = a0i - ti;
+                a0r = a0r + tr; a0i = a0i + ti;
+
+                tr = a3r*twr0[2*j + 0] + a3i*twi0[2*j + 0];
+                ti = a3i*twr0[2*j + 1] + a3r*twi0[2*j + 1];
+                a3r = a2r - tr; a3i = a2i - ti;
+                a2r = a2r + tr; a2i = a2i + ti;
+
+                tr = a2r*twr1[2*j + 0] + a2i*twi1[2*j + 0];
+                ti = a2i*twr1[2*j + 1] + a2r*twi1[2*j + 1];
+                x2[0] = a0r - tr; x2[1] = a0i - ti;
+                x0[0] = a0r + tr; x0[1] = a0i + ti;
+
+                tr = a3r*twr1[2*(j + h) + 0] + a3i*twi1[2*(j + h) + 0];
+                ti = a3i*twr1[2*(j + h) + 1] + a3r*twi1[2*(j + h) + 1];
+                x3[0] = a1r - tr; x3[1] = a1i - ti;
+                x1[0] = a1r + tr; x1[1] = a1i + ti;
+            }
+        }
+    }
+
+    // the last stage, if the number of stages is odd
+    for (; h < m; h *= 2) {
+        const float * twr = plan.twr + 2*(h - 1);
+        const float * twi = plan.twi + 2*(h - 1);
+
+        for (int k = 0; k < m; k += 2*h) {
+            for (int j = 0; j < h; ++j) {
+                V * u = x + 2*(k + j);
+                V * v = x + 2*(k + j + h);
+
+                const V tr = v[0]*twr[2*j + 0] + v[1]*twi[2*j + 0];
+                const V ti = v[1]*twr[2*j + 1] + v[0]*twi[2*j + 1];
+
+                v[0] = u[0] - tr;
+                v[1] = u[1] - ti;
+                u[0] = u[0] + tr;
+                u[1] = u[1] + ti;
+            }
+        }
+    }
+
+    for (int k = 1; k < m/2; ++k) {
+        V * p = x + 2*k;
+        V * q = x + 2*(m - k);
+
+        const V sr = p[0] + q[0];
+        const V si = p[1] + q[1];
+        const V dr = p[0] - q[0];
+        const V di = p[1] - q[1];
+
+        const V hr = sr*0.5f;
+        const V hi = di*0.5f;
+        const V gr = si*0.5f;
+        const V gi = dr*(-0.5f);
+
+        const V tr = gr*plan.postr[2*k + 0] + gi*plan.posti[2*k + 0];
+        const V ti = gi*plan.postr[2*k + 1] + gr*plan.posti[2*k + 1];
+
+        p[0] =   hr + tr;
+        p[1] = -(hi + ti);
+        q[0] =   hr - tr;
+        q[1] =   hi - ti;
+    }
+
+    const V r = x[0];
+    const V i = x[1];
+
+    x[0] = r + i;
+    x[1] = r - i;
+}
+
+// the frames that do not fill a batch
+template <void (*F)(const Plan &, float *)>
+inline void rdftFrames(const Plan & plan, const float * src, float * dst, int count) {
+    for (int i = 0; i < count; ++i) {
+        if (src != dst) {
+            memcpy(dst + i*plan.n, src + i*plan.n, plan.n*sizeof(float));
+        }
+        F(plan, dst + i*plan.n);
+    }
+}
+
+//
+// band
+//
+// The band transform computes the bins [bin0, bin1) of the real FFT of n samples, without the other bins. The samples
+// are split into the L interleaved sequences y_p[q] = a[q*L + p], which are transformed at once by rdftLanes() - in
+// natural order, the samples already have the layout of the lanes. A bin of the band is then the sum of the L spectra
+// at the same bin modulo n/L:
+//
+//     A[k] = sum_p exp(2*pi*i*p*k/n)*Y_p[k mod n/L]
+//
+// This costs a transform of n/L samples per lane, plus L complex products per bin, so that it is faster than the full
+// transform only for narrow bands - see bandFaster().
+//
+
+// the transforms of the L sequences - the samples of x are replaced by the spectra, in the layout of rdftLanes()
+template <typename V>
+__attribute__((always_inline))
+inline void bandLanes(const Plan & sub, const float * src, V * x) {
+    constexpr int L = sizeof(V)/sizeof(float);
+
+    // the complex sample c of all lanes is the 2*L samples at src + 2*c*L
+    for (int c = 0; c < sub.m; ++c) {
+        memcpy(x + 2*sub.rev[c], src + 2*c*L, 2*sizeof(V));
+    }
+
+    rdftLanes(sub, x);
+}
+
+// the terms of the bins k0 .. k0 + L - 1 - the bin k0 + i is the sum of the lanes of re[i] and im[i]
+//   tw - the twiddles of bin k at 16*k: cos(2*pi*p*k/n) for p < kMaxLanes, then sin(2*pi*p*k/n)
+template <typename V>
+__attribute__((always_inline))
+inline void bandBins(const Plan & sub, const float * tw, const V * x, int k0, V * re, V * im) {
+    constexpr int L = sizeof(V)/sizeof(float);
+
+    const int q = sub.n;
+    const V zero = {};
+
+    for (int i = 0; i < L; ++i) {
+        const int k = k0 + i;
+        const int r = k & (q - 1);
+
+        // the bins above q/2 are the conjugates of the bins below, bin q/2 is packed into x[1]
+        V yr, yi;
+        if (r == 0 || 2*r == q) {
+            yr = x[r == 0 ? 0 : 1];
+            yi = zero;
+        } else if (2*r < q) {
+            yr =  x[2*r + 0];
+            yi =  x[2*r + 1];
+        } else {
+            yr =  x[2*(q - r) + 0];
+            yi = -x[2*(q - r) + 1];
+        }
+
+        V c, s;
+        memcpy(&c, tw + 16*k + 0, sizeof(V));
+        memcpy(&s, tw + 16*k + 8, sizeof(V));
+
+        re[i] = c*yr - s*yi;
+        im[i] = c*yi + s*yr;
+    }
+}
+
+// bin n/2, packed into a[1] - n/2 is a multiple of n/L, so the twiddles alternate in sign
+template <typename V>
+__attribute__((always_inline))
+inline float bandNyquist(const V * x) {
+    constexpr int L = sizeof(V)/sizeof(float);
+
+    float res = 0.0f;
+    for (int p = 0; p < L; ++p) {
+        res += p % 2 ? -x[0][p] : x[0][p];
+    }
+
+    return res;
+}
+
+#endif
+
+#if defined(GGWAVE_SIMD_X86)
+
+//
+// SSE2
+//
+
+inline __m128 swapPairs_sse2(__m128 x) {
+    return _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+template <int M = 0>
+inline void stage1_sse2(const Plan & plan, float * a) {
+    const int m = M > 0 ? M : plan.m;
+
+    const __m128 sign = _mm_setr_ps(1.0f, 1.0f, -1.0f, -1.0f);
+
+    for (int k = 0; k < m; k += 2) {
+        const __m128 x = _mm_loadu_ps(a + 2*k);
+        const __m128 u = _mm_movelh_ps(x, x);
+        const __m128 v = _mm_movehl_ps(x, x);
+        _mm_storeu_ps(a + 2*k, _mm_add_ps(u, _mm_mul_ps(v, sign)));
+    }
+}
+
+template <int M = 0, int H = 0>
+inline void stage_sse2(const Plan & plan, float * a, int hp = H) {
+    const int m = M > 0 ? M : plan.m;
+    const int h = H > 0 ? H : hp;
+
+    const float * twr = plan.twr + 2*(h - 1);
+    const float * twi = plan.twi + 2*(h - 1);
+
+    for (int k = 0; k < m; k += 2*h) {
+        for (int j = 0; j < h; j += 2) {
+            float * u = a + 2*(k + j);
+            float * v = a + 2*(k + j + h);
+
+            const __m128 x = _mm_loadu_ps(v);
+            const __m128 t = _mm_add_ps(_mm_mul_ps(x, _mm_loadu_ps(twr + 2*j)), _mm_mul_ps(swapPairs_sse2(x), _mm_loadu_ps(twi + 2*j)));
+            const __m128 y = _mm_loadu_ps(u);
+
+            _mm_storeu_ps(v, _mm_sub_ps(y, t));
+            _mm_storeu_ps(u, _mm_add_ps(y, t));
+        }
+    }
+}
+
+template <int M = 0>
+inline void post_sse2(const Plan & plan, float * a) {
+    const int m = M > 0 ? M : plan.m;
+
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 signG = _mm_setr_ps(0.5f, -0.5f, 0.5f, -0.5f);
+    const __m128 signF = _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f);
+
+    // bins k, k + 1 and m - k, m - k - 1
+    int k = 1;
+    for (; k + 1 < m/2; k += 2) {
+        float * x = a + 2*k;
+        float * y = a + 2*(m - k - 1);
+
+        const __m128 xv = _mm_loadu_ps(x);
+        const __m128 yv = _mm_loadu_ps(y);
+        const __m128 yr = _mm_shuffle_ps(yv, yv, _MM_SHUFFLE(1, 0, 3, 2));
+
+        const __m128 s = _mm_add_ps(xv, yr);
+        const __m128 d = _mm_sub_ps(xv, yr);
+
+        // [sr, di, ...] and [si, dr, ...]
+        __m128 hv = _mm_shuffle_ps(s, d, _MM_SHUFFLE(3, 1, 2, 0));
+        __m128 gv = _mm_shuffle_ps(s, d, _MM_SHUFFLE(2, 0, 3, 1));
+        hv = _mm_mul_ps(_mm_shuffle_ps(hv, hv, _MM_SHUFFLE(3, 1, 2, 0)), half);
+        gv = _mm_mul_ps(_mm_shuffle_ps(gv, gv, _MM_SHUFFLE(3, 1, 2, 0)), signG);
+
+        const __m128 t = _mm_add_ps(_mm_mul_ps(gv, _mm_loadu_ps(plan.postr + 2*k)), _mm_mul_ps(swapPairs_sse2(gv), _mm_loadu_ps(plan.posti + 2*k)));
+
+        const __m128 f = _mm_mul_ps(_mm_add_ps(hv, t), signF);
+        const __m128 b = _mm_sub_ps(hv, t);
+
+        _mm_storeu_ps(x, f);
+        _mm_storeu_ps(y, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2)));
+    }
+
+    post_scalar<M>(plan, a, k, m/2);
+}
+
+inline void rdft_sse2(const Plan & plan, float * a) {
+    if (plan.m > 1) {
+        bitReverse(plan, a);
+        stage1_sse2(plan, a);
+        for (int h = 2; h < plan.m; h *= 2) {
+            stage_sse2(plan, a, h);
+        }
+        post_sse2(plan, a);
+    }
+
+    postDC(a);
+}
+
+template <int M, int H, bool = (H < M)>
+struct Stages_sse2 {
+    static void run(const Plan & plan, float * a) {
+        stage_sse2<M, H>(plan, a);
+        Stages_sse2<M, 2*H>::run(plan, a);
+    }
+};
+
+template <int M, int H>
+struct Stages_sse2<M, H, false> {
+    static void run(const Plan & , float * ) {}
+};
+
+template <int K>
+struct Fixed_sse2 {
+    static constexpr int M = (1 << K)/2;
+
+    static void rdft(float * a) {
+        const Plan & plan = planLog2<K>();
+
+        bitReverse<M>(plan, a);
+        stage1_sse2<M>(plan, a);
+        Stages_sse2<M, 2>::run(plan, a);
+        post_sse2<M>(plan, a);
+        postDC(a);
+    }
+};
+
+// 1 <= count <= 4 frames - the missing lanes transform a copy of the first frame
+inline void lanes_sse2(const Plan & plan, const float * src, float * dst, int count, float * work) {
+    work = alignWork(work);
+
+    const int n = plan.n;
+    const int m = plan.m;
+
+    const float * s0 = src;
+    const float * s1 = src + (count > 1 ? 1 : 0)*n;
+    const float * s2 = src + (count > 2 ? 2 : 0)*n;
+    const float * s3 = src + (count > 3 ? 3 : 0)*n;
+
+    // the complex samples c and c + 1 of each frame go to rev[c] and rev[c] + m/2
+    //   m >= 2^(kMinLog2Batch - 1), and the loop runs at least once, so that the compiler sees that work is written
+    int c = 0;
+    do {
+        __m128 r0 = _mm_loadu_ps(s0 + 2*c);
+        __m128 r1 = _mm_loadu_ps(s1 + 2*c);
+        __m128 r2 = _mm_loadu_ps(s2 + 2*c);
+        __m128 r3 = _mm_loadu_ps(s3 + 2*c);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        float * p = work + 8*plan.rev[c];
+        float * q = p + 8*(m/2);
+        _mm_store_ps(p + 0, r0);
+        _mm_store_ps(p + 4, r1);
+        _mm_store_ps(q + 0, r2);
+        _mm_store_ps(q + 4, r3);
+
+        c += 2;
+    } while (c < m);
+
+    rdftLanes(plan, (f32x4 *) work);
+
+    for (int k = 0; k < m; k += 2) {
+        const float * p = work + 8*k;
+        __m128 r0 = _mm_load_ps(p + 0);
+        __m128 r1 = _mm_load_ps(p + 4);
+        __m128 r2 = _mm_load_ps(p + 8);
+        __m128 r3 = _mm_load_ps(p + 12);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        float * d = dst + 2*k;
+                       _mm_storeu_ps(d + 0*n, r0);
+        if (count > 1) _mm_storeu_ps(d + 1*n, r1);
+        if (count > 2) _mm_storeu_ps(d + 2*n, r2);
+        if (count > 3) _mm_storeu_ps(d + 3*n, r3);
+    }
+}
+
+// a batch of 3 frames is still faster than 3 single transforms
+inline void rdftBatch_sse2(const Plan & plan, const float * src, float * dst, int count, float * work) {
+    int i = 0;
+    if (plan.n >= (1 << kMinLog2Batch)) {
+        while (count - i >= 3) {
+            const int nFrames = count - i < 4 ? count - i : 4;
+            lanes_sse2(plan, src + i*plan.n, dst + i*plan.n, nFrames, work);
+            i += nFrames;
+        }
+    }
+
+    rdftFrames<rdft_sse2>(plan, src + i*plan.n, dst + i*plan.n, count - i);
+}
+
+// the bins [bin0, bin1) of 4*sub.n samples, 0 <= bin0 < bin1 <= 2*sub.n
+inline void rdftBand_sse2(const Plan & sub, const float * tw, const float * src, float * dst, int bin0, int bin1, float * work) {
+    f32x4 * x = (f32x4 *) alignWork(work);
+    bandLanes(sub, src, x);
+
+    for (int k = bin0; k < bin1; k += 4) {
+        f32x4 re[4], im[4];
+        bandBins(sub, tw, x, k, re, im);
+
+        __m128 r0 = _mm_load_ps((const float *) (re + 0));
+        __m128 r1 = _mm_load_ps((const float *) (re + 1));
+        __m128 r2 = _mm_load_ps((const float *) (re + 2));
+        __m128 r3 = _mm_load_ps((const float *) (re + 3));
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        __m128 i0 = _mm_load_ps((const float *) (im + 0));
+        __m128 i1 = _mm_load_ps((const float *) (im + 1));
+        __m128 i2 = _mm_load_ps((const float *) (im + 2));
+        __m128 i3 = _mm_load_ps((const float *) (im + 3));
+        _MM_TRANSPOSE4_PS(i0, i1, i2, i3);
+
+        const __m128 sr = _mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3));
+        const __m128 si = _mm_add_ps(_mm_add_ps(i0, i1), _mm_add_ps(i2, i3));
+
+        if (bin1 - k >= 4) {
+            _mm_storeu_ps(dst + 2*k + 0, _mm_unpacklo_ps(sr, si));
+            _mm_storeu_ps(dst + 2*k + 4, _mm_unpackhi_ps(sr, si));
+        } else {
+            alignas(16) float tmp[8];
+            _mm_store_ps(tmp + 0, _mm_unpacklo_ps(sr, si));
+            _mm_store_ps(tmp + 4, _mm_unpackhi_ps(sr, si));
+            memcpy(dst + 2*k, tmp, 2*(bin1 - k)*sizeof(float));
+        }
+    }
+
+    if (bin0 == 0) {
+        dst[1] = bandNyquist(x);
+    }
+}
+
+//
+// AVX2
+//
+// the first stages and the split into the real spectrum use the SSE2 kernels
+//
+
+template <int M = 0, int H = 0>
+__attribute__((target("avx2")))
+inline void stage_avx2(const Plan & plan, float * a, int hp = H) {
+    const int m = M > 0 ? M : plan.m;
+    const int h = H > 0 ? H : hp;
+
+    const float * twr = plan.twr + 2*(h - 1);
+    const float * twi = plan.twi + 2*(h - 1);
+
+    for (int k = 0; k < m; k += 2*h) {
+        for (int j = 0; j < h; j += 4) {
+            float * u = a + 2*(k + j);
+            float * v = a + 2*(k + j + h);
+
+            const __m256 x = _mm256_loadu_ps(v);
+            const __m256 t = _mm256_add_ps(_mm256_mul_ps(x, _mm256_loadu_ps(twr + 2*j)), _mm256_mul_ps(_mm256_permute_ps(x, 0xB1), _mm256_loadu_ps(twi + 2*j)));
+            const __m256 y = _mm256_loadu_ps(u);
+
+            _mm256_storeu_ps(v, _mm256_sub_ps(y, t));
+            _mm256_storeu_ps(u, _mm256_add_ps(y, t));
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+inline void rdft_avx2(const Plan & plan, float * a) {
+    if (plan.m > 1) {
+        bitReverse(plan, a);
+        stage1_sse2(plan, a);
+        for (int h = 2; h < plan.m; h *= 2) {
+            if (h < 4) {
+                stage_sse2(plan, a, h);
+            } else {
+                stage_avx2(plan, a, h);
+            }
+        }
+        post_sse2(plan, a);
+    }
+
+    postDC(a);
+}
+
+template <int M, int H, bool = (H < M)>
+struct Stages_avx2 {
+    __attribute__((target("avx2")))
+    static void run(const Plan & plan, float * a) {
+        stage_avx2<M, H>(plan, a);
+        Stages_avx2<M, 2*H>::run(plan, a);
+    }
+};
+
+template <int M, int H>
+struct Stages_avx2<M, H, false> {
+    static void run(const Plan & , float * ) {}
+};
+
+template <int K>
+struct Fixed_avx2 {
+    static constexpr int M = (1 << K)/2;
+
+    __attribute__((target("avx2")))
+    static void rdft(float * a) {
+        const Plan & plan = planLog2<K>();
+
+        bitReverse<M>(plan, a);
+        stage1_sse2<M>(plan, a);
+        stage_sse2<M, 2>(plan, a);
+        Stages_avx2<M, 4>::run(plan, a);
+        post_sse2<M>(plan, a);
+        postDC(a);
+    }
+};
+
+#define GGWAVE_TRANSPOSE8_PS(r0, r1, r2, r3, r4, r5, r6, r7) do { \
+    const __m256 t0 = _mm256_unpacklo_ps(r0, r1); \
+    const __m256 t1 = _mm256_unpackhi_ps(r0, r1); \
+    const __m256 t2 = _mm256_unpacklo_ps(r2, r3); \
+    const __m256 t3 = _mm256_unpackhi_ps(r2, r3); \
+    const __m256 t4 = _mm256_unpacklo_ps(r4, r5); \
+    const __m256 t5 = _mm256_unpackhi_ps(r4, r5); \
+    const __m256 t6 = _mm256_unpacklo_ps(r6, r7); \
+    const __m256 t7 = _mm256_unpackhi_ps(r6, r7); \
+    const __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)); \
+    const __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)); \
+    const __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)); \
+    const __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)); \
+    const __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0)); \
+    const __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2)); \
+    const __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0)); \
+    const __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2)); \
+    r0 = _mm256_permute2f128_ps(u0, u4, 0x20); \
+    r1 = _mm256_permute2f128_ps(u1, u5, 0x20); \
+    r2 = _mm256_permute2f128_ps(u2, u6, 0x20); \
+    r3 = _mm256_permute2f128_ps(u3, u7, 0x20); \
+    r4 = _mm256_permute2f128_ps(u0, u4, 0x31); \
+    r5 = _mm256_permute2f128_ps(u1, u5, 0x31); \
+    r6 = _mm256_permute2f128_ps(u2, u6, 0x31); \
+    r7 = _mm256_permute2f128_ps(u3, u7, 0x31); \
+} while (0)
+
+// 1 <= count <= 8 frames - the missing lanes transform a copy of the first frame
+__attribute__((target("avx2")))
+inline void lanes_avx2(const Plan & plan, const float * src, float * dst, int count, float * work) {
+    work = alignWork(work);
+
+    const int n = plan.n;
+    const int m = plan.m;
+
+    const float * s0 = src;
+    const float * s1 = src + (count > 1 ? 1 : 0)*n;
+    const float * s2 = src + (count > 2 ? 2 : 0)*n;
+    const float * s3 = src + (count > 3 ? 3 : 0)*n;
+    const float * s4 = src + (count > 4 ? 4 : 0)*n;
+    const float * s5 = src + (count > 5 ? 5 : 0)*n;
+    const float * s6 = src + (count > 6 ? 6 : 0)*n;
+    const float * s7 = src + (count > 7 ? 7 : 0)*n;
+
+    // the complex samples c, c + 1, c + 2 and c + 3 of each frame go to rev[c] + 0, m/2, m/4 and 3*m/4
+    //   m >= 2^(kMinLog2Batch - 1), and the loop runs at least once, so that the compiler sees that work is written
+    int c = 0;
+    do {
+        __m256 r0 = _mm256_loadu_ps(s0 + 2*c);
+        __m256 r1 = _mm256_loadu_ps(s1 + 2*c);
+        __m256 r2 = _mm256_loadu_ps(s2 + 2*c);
+        __m256 r3 = _mm256_loadu_ps(s3 + 2*c);
+        __m256 r4 = _mm256_loadu_ps(s4 + 2*c);
+        __m256 r5 = _mm256_loadu_ps(s5 + 2*c);
+        __m256 r6 = _mm256_loadu_ps(s6 + 2*c);
+        __m256 r7 = _mm256_loadu_ps(s7 + 2*c);
+        GGWAVE_TRANSPOSE8_PS(r0, r1, r2, r3, r4, r5, r6, r7);
+
+        float * p = work + 16*plan.rev[c];
+        _mm256_store_ps(p + 16*(0*m/4) + 0, r0);
+        _mm256_store_ps(p + 16*(0*m/4) + 8, r1);
+        _mm256_store_ps(p + 16*(2*m/4) + 0, r2);
+        _mm256_store_ps(p + 16*(2*m/4) + 8, r3);
+        _mm256_store_ps(p + 16*(1*m/4) + 0, r4);
+        _mm256_store_ps(p + 16*(1*m/4) + 8, r5);
+        _mm256_store_ps(p + 16*(3*m/4) + 0, r6);
+        _mm256_store_ps(p + 16*(3*m/4) + 8, r7);
+
+        c += 4;
+    } while (c < m);
+
+    rdftLanes(plan, (f32x8 *) work);
+
+    for (int k = 0; k < m; k += 4) {
+        const float * p = work + 16*k;
+        __m256 r0 = _mm256_load_ps(p + 0);
+        __m256 r1 = _mm256_load_ps(p + 8);
+        __m256 r2 = _mm256_load_ps(p + 16);
+        __m256 r3 = _mm256_load_ps(p + 24);
+        __m256 r4 = _mm256_load_ps(p + 32);
+        __m256 r5 = _mm256_load_ps(p + 40);
+        __m256 r6 = _mm256_load_ps(p + 48);
+        __m256 r7 = _mm256_load_ps(p + 56);
+        GGWAVE_TRANSPOSE8_PS(r0, r1, r2, r3, r4, r5, r6, r7);
+
+        float * d = dst + 2*k;
+                       _mm256_storeu_ps(d + 0*n, r0);
+        if (count > 1) _mm256_storeu_ps(d + 1*n, r1);
+        if (count > 2) _mm256_storeu_ps(d + 2*n, r2);
+        if (count > 3) _mm256_storeu_ps(d + 3*n, r3);
+        if (count > 4) _mm256_storeu_ps(d + 4*n, r4);
+        if (count > 5) _mm256_storeu_ps(d + 5*n, r5);
+        if (count > 6) _mm256_storeu_ps(d + 6*n, r6);
+        if (count > 7) _mm256_storeu_ps(d + 7*n, r7);
+    }
+}
+
+#undef GGWAVE_TRANSPOSE8_PS
+
+// a batch of 8 lanes costs about 4 single transforms and a batch of 4 lanes about 3
+__attribute__((target("avx2")))
+inline void rdftBatch_avx2(const Plan & plan, const float * src, float * dst, int count, float * work) {
+    int i = 0;
+    if (plan.n >= (1 << kMinLog2Batch)) {
+        while (count - i >= 5) {
+            const int nFrames = count - i < 8 ? count - i : 8;
+            lanes_avx2(plan, src + i*plan.n, dst + i*plan.n, nFrames, work);
+            i += nFrames;
+        }
+        if (count - i >= 3) {
+            const int nFrames = count - i;
+            lanes_sse2(plan, src + i*plan.n, dst + i*plan.n, nFrames, work);
+            i += nFrames;
+        }
+    }
+
+    rdftFrames<rdft_avx2>(plan, src + i*plan.n, dst + i*plan.n, count - i);
+}
+
+// the bins [bin0, bin1) of 8*sub.n samples, 0 <= bin0 < bin1 <= 4*sub.n
+__attribute__((target("avx2")))
+inline void rdftBand_avx2(const Plan & sub, const float * tw, const float * src, float * dst, int bin0, int bin1, float * work) {
+    f32x8 * x = (f32x8 *) alignWork(work);
+    bandLanes(sub, src, x);
+
+    for (int k = bin0; k < bin1; k += 8) {
+        f32x8 re[8], im[8];
+        bandBins(sub, tw, x, k, re, im);
+
+        // the sums of the lanes of the 8 bins
+        __m256 sr, si;
+        {
+            const __m256 a = _mm256_hadd_ps(_mm256_load_ps((const float *) (re + 0)), _mm256_load_ps((const float *) (re + 1)));
+            const __m256 b = _mm256_hadd_ps(_mm256_load_ps((const float *) (re + 2)), _mm256_load_ps((const float *) (re + 3)));
+            const __m256 c = _mm256_hadd_ps(_mm256_load_ps((const float *) (re + 4)), _mm256_load_ps((const float *) (re + 5)));
+            const __m256 d = _mm256_hadd_ps(_mm256_load_ps((const float *) (re + 6)), _mm256_load_ps((const float *) (re + 7)));
+            const __m256 e = _mm256_hadd_ps(a, b);
+            const __m256 f = _mm256_hadd_ps(c, d);
+            sr = _mm256_add_ps(_mm256_permute2f128_ps(e, f, 0x20), _mm256_permute2f128_ps(e, f, 0x31));
+        }
+        {
+            const __m256 a = _mm256_hadd_ps(_mm256_load_ps((const float *) (im + 0)), _mm256_load_ps((const float *) (im + 1)));
+            const __m256 b = _mm256_hadd_ps(_mm256_load_ps((const float *) (im + 2)), _mm256_load_ps((const float *) (im + 3)));
+            const __m256 c = _mm256_hadd_ps(_mm256_load_ps((const float *) (im + 4)), _mm256_load_ps((const float *) (im + 5)));
+            const __m256 d = _mm256_hadd_ps(_mm256_load_ps((const float *) (im + 6)), _mm256_load_ps((const float *) (im + 7)));
+            const __m256 e = _mm256_hadd_ps(a, b);
+            const __m256 f = _mm256_hadd_ps(c, d);
+            si = _mm256_add_ps(_mm256_permute2f128_ps(e, f, 0x20), _mm256_permute2f128_ps(e, f, 0x31));
+        }
+
+        const __m256 lo = _mm256_unpacklo_ps(sr, si);
+        const __m256 hi = _mm256_unpackhi_ps(sr, si);
+        const __m256 o0 = _mm256_permute2f128_ps(lo, hi, 0x20);
+        const __m256 o1 = _mm256_permute2f128_ps(lo, hi, 0x31);
+
+        if (bin1 - k >= 8) {
+            _mm256_storeu_ps(dst + 2*k + 0, o0);
+            _mm256_storeu_ps(dst + 2*k + 8, o1);
+        } else {
+            alignas(32) float tmp[16];
+            _mm256_store_ps(tmp + 0, o0);
+            _mm256_store_ps(tmp + 8, o1);
+            memcpy(dst + 2*k, tmp, 2*(bin1 - k)*sizeof(float));
+        }
+    }
+
+    if (bin0 == 0) {
+        dst[1] = bandNyquist(x);
+    }
+}
+
+#elif defined(GGWAVE_SIMD_NEON)
+
+//
+// NEON
+//
+
+template <int M = 0>
+inline void stage1_neon(const Plan & plan, float * a) {
+    const int m = M > 0 ? M : plan.m;
+
+    const float kSign[4] = { 1.0f, 1.0f, -1.0f, -1.0f };
+    const float32x4_t sign = vld1q_f32(kSign);
+
+    for (int k = 0; k < m; k += 2) {
+        const float32x4_t x = vld1q_f32(a + 2*k);
+        const float32x4_t u = vcombine_f32(vget_low_f32(x), vget_low_f32(x));
+        const float32x4_t v = vcombine_f32(vget_high_f32(x), vget_high_f32(x));
+        vst1q_f32(a + 2*k, vaddq_f32(u, vmulq_f32(v, sign)));
+    }
+}
+
+template <int M = 0, int H = 0>
+inline void stage_neon(const Plan & plan, float * a, int hp = H) {
+    const int m = M > 0 ? M : plan.m;
+    const int h = H > 0 ? H : hp;
+
+    const float * twr = plan.twr + 2*(h - 1);
+    const float * twi = plan.twi + 2*(h - 1);
+
+    for (int k = 0; k < m; k += 2*h) {
+        for (int j = 0; j < h; j += 2) {
+            float * u = a + 2*(k + j);
+            float * v = a + 2*(k + j + h);
+
+            const float32x4_t x = vld1q_f32(v);
+            const float32x4_t t = vaddq_f32(vmulq_f32(x, vld1q_f32(twr + 2*j)), vmulq_f32(vrev64q_f32(x), vld1q_f32(twi + 2*j)));
+            const float32x4_t y = vld1q_f32(u);
+
+            vst1q_f32(v, vsubq_f32(y, t));
+            vst1q_f32(u, vaddq_f32(y, t));
+        }
+    }
+}
+
+template <int M = 0>
+inline void post_neon(const Plan & plan, float * a) {
+    const int m = M > 0 ? M : plan.m;
+
+    const float kSignG[4] = { 0.5f, -0.5f, 0.5f, -0.5f };
+    const float kSignF[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
+    const uint32_t kEven[4] = { 0xFFFFFFFF, 0, 0xFFFFFFFF, 0 };
+
+    const float32x4_t half  = vdupq_n_f32(0.5f);
+    const float32x4_t signG = vld1q_f32(kSignG);
+    const float32x4_t signF = vld1q_f32(kSignF);
+    const uint32x4_t  even  = vld1q_u32(kEven);
+
+    // bins k, k + 1 and m - k, m - k - 1
+    int k = 1;
+    for (; k + 1 < m/2; k += 2) {
+        float * x = a + 2*k;
+        float * y = a + 2*(m - k - 1);
+
+        const float32x4_t xv = vld1q_f32(x);
+        const float32x4_t yv = vld1q_f32(y);
+        const float32x4_t yr = vcombine_f32(vget_high_f32(yv), vget_low_f32(yv));
+
+        const float32x4_t s = vaddq_f32(xv, yr);
+        const float32x4_t d = vsubq_f32(xv, yr);
+
+        // [sr, di, ...] and [si, dr, ...]
+        const float32x4_t hv = vmulq_f32(vbslq_f32(even, s, d), half);
+        const float32x4_t gv = vmulq_f32(vrev64q_f32(vbslq_f32(even, d, s)), signG);
+
+        const float32x4_t t = vaddq_f32(vmulq_f32(gv, vld1q_f32(plan.postr + 2*k)), vmulq_f32(vrev64q_f32(gv), vld1q_f32(plan.posti + 2*k)));
+
+        const float32x4_t f = vmulq_f32(vaddq_f32(hv, t), signF);
+        const float32x4_t b = vsubq_f32(hv, t);
+
+        vst1q_f32(x, f);
+        vst1q_f32(y, vcombine_f32(vget_high_f32(b), vget_low_f32(b)));
+    }
+
+    post_scalar<M>(plan, a, k, m/2);
+}
+
+inline void rdft_neon(const Plan & plan, float * a) {
+    if (plan.m > 1) {
+        bitReverse(plan, a);
+        stage1_neon(plan, a);
+        for (int h = 2; h < plan.m; h *= 2) {
+            stage_neon(plan, a, h);
+        }
+        post_neon(plan, a);
+    }
+
+    postDC(a);
+}
+
+template <int M, int H, bool = (H < M)>
+struct Stages_neon {
+    static void run(const Plan & plan, float * a) {
+        stage_neon<M, H>(plan, a);
+        Stages_neon<M, 2*H>::run(plan, a);
+    }
+};
+
+template <int M, int H>
+struct Stages_neon<M, H, false> {
+    static void run(const Plan & , float * ) {}
+};
+
+template <int K>
+struct Fixed_neon {
+    static constexpr int M = (1 << K)/2;
+
+    static void rdft(float * a) {
+        const Plan & plan = planLog2<K>();
+
+        bitReverse<M>(plan, a);
+        stage1_neon<M>(plan, a);
+        Stages_neon<M, 2>::run(plan, a);
+        post_neon<M>(plan, a);
+        postDC(a);
+    }
+};
+
+inline void transpose4_neon(float32x4_t & r0, float32x4_t & r1, float32x4_t & r2, float32x4_t & r3) {
+    const float32x4x2_t t01 = vtrnq_f32(r0, r1);
+    const float32x4x2_t t23 = vtrnq_f32(r2, r3);
+
+    r0 = vcombine_f32(vget_low_f32 (t01.val[0]), vget_low_f32 (t23.val[0]));
+    r1 = vcombine_f32(vget_low_f32 (t01.val[1]), vget_low_f32 (t23.val[1]));
+    r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+// 1 <= count <= 4 frames - the missing lanes transform a copy of the first frame
+inline void lanes_neon(const Plan & plan, const float * src, float * dst, int count, float * work) {
+    work = alignWork(work);
+
+    const int n = plan.n;
+    const int m = plan.m;
+
+    const float * s0 = src;
+    const float * s1 = src + (count > 1 ? 1 : 0)*n;
+    const float * s2 = src + (count > 2 ? 2 : 0)*n;
+    const float * s3 = src + (count > 3 ? 3 : 0)*n;
+
+    // the complex samples c and c + 1 of each frame go to rev[c] and rev[c] + m/2
+    //   m >= 2^(kMinLog2Batch - 1), and the loop runs at least once, so that the compiler sees that work is written
+    int c = 0;
+    do {
+        float32x4_t r0 = vld1q_f32(s0 + 2*c);
+        float32x4_t r1 = vld1q_f32(s1 + 2*c);
+        float32x4_t r2 = vld1q_f32(s2 + 2*c);
+        float32x4_t r3 = vld1q_f32(s3 + 2*c);
+        transpose4_neon(r0, r1, r2, r3);
+
+        float * p = work + 8*plan.rev[c];
+        float * q = p + 8*(m/2);
+        vst1q_f32(p + 0, r0);
+        vst1q_f32(p + 4, r1);
+        vst1q_f32(q + 0, r2);
+        vst1q_f32(q + 4, r3);
+
+        c += 2;
+    } while (c < m);
+
+    rdftLanes(plan, (f32x4 *) work);
+
+    for (int k = 0; k < m; k += 2) {
+        const float * p = work + 8*k;
+        float32x4_t r0 = vld1q_f32(p + 0);
+        float32x4_t r1 = vld1q_f32(p + 4);
+        float32x4_t r2 = vld1q_f32(p + 8);
+        float32x4_t r3 = vld1q_f32(p + 12);
+        transpose4_neon(r0, r1, r2, r3);
+
+        float * d = dst + 2*k;
+                       vst1q_f32(d + 0*n, r0);
+        if (count > 1) vst1q_f32(d + 1*n, r1);
+        if (count > 2) vst1q_f32(d + 2*n, r2);
+        if (count > 3) vst1q_f32(d + 3*n, r3);
+    }
+}
+
+// a batch of 3 frames is still faster than 3 single transforms
+inline void rdftBatch_neon(const Plan & plan, const float * src, float * dst, int count, float * work) {
+    int i = 0;
+    if (plan.n >= (1 << kMinLog2Batch)) {
+        while (count - i >= 3) {
+            const int nFrames = count - i < 4 ? count - i : 4;
+            lanes_neon(plan, src + i*plan.n, dst + i*plan.n, nFrames, work);
+            i += nFrames;
+        }
+    }
+
+    rdftFrames<rdft_neon>(plan, src + i*plan.n, dst + i*plan.n, count - i);
+}
+
+// the bins [bin0, bin1) of 4*sub.n samples, 0 <= bin0 < bin1 <= 2*sub.n
+inline void rdftBand_neon(const Plan & sub, const float * tw, const float * src, float * dst, int bin0, int bin1, float * work) {
+    f32x4 * x = (f32x4 *) alignWork(work);
+    bandLanes(sub, src, x);
+
+    for (int k = bin0; k < bin1; k += 4) {
+        f32x4 re[4], im[4];
+        bandBins(sub, tw, x, k, re, im);
+
+        float32x4_t r0 = vld1q_f32((const float *) (re + 0));
+        float32x4_t r1 = vld1q_f32((const float *) (re + 1));
+        float32x4_t r2 = vld1q_f32((const float *) (re + 2));
+        float32x4_t r3 = vld1q_f32((const float *) (re + 3));
+        transpose4_neon(r0, r1, r2, r3);
+
+        float32x4_t i0 = vld1q_f32((const float *) (im + 0));
+        float32x4_t i1 = vld1q_f32((const float *) (im + 1));
+        float32x4_t i2 = vld1q_f32((const float *) (im + 2));
+        float32x4_t i3 = vld1q_f32((const float *) (im + 3));
+        transpose4_neon(i0, i1, i2, i3);
+
+        float32x4x2_t out;
+        out.val[0] = vaddq_f32(vaddq_f32(r0, r1), vaddq_f32(r2, r3));
+        out.val[1] = vaddq_f32(vaddq_f32(i0, i1), vaddq_f32(i2, i3));
+
+        if (bin1 - k >= 4) {
+            vst2q_f32(dst + 2*k, out);
+        } else {
+            alignas(16) float tmp[8];
+            vst2q_f32(tmp, out);
+            memcpy(dst + 2*k, tmp, 2*(bin1 - k)*sizeof(float));
+        }
+    }
+
+    if (bin0 == 0) {
+        dst[1] = bandNyquist(x);
+    }
+}
+
+#endif
+
+//
+// backends
+//
+
+// in-place real FFT of a size fixed by the function
+using Transform = void (*)(float * a);
+
+// the transform of size 2^K with the kernels that read the size from the plan
+template <int K, void (*F)(const Plan &, float *)>
+inline void rdftPlan(float * a) {
+    F(planLog2<K>(), a);
+}
+
+// the transform of size n, nullptr if n has no plan
+//   F     - kernels for any size
+//   Fixed - kernels for the sizes 2^kMinLog2Fixed .. 2^kMaxLog2
+template <void (*F)(const Plan &, float *), template <int> class Fixed>
+inline Transform transformFor(int n) {
+    switch (n) {
+        case    2: return rdftPlan<1, F>;
+        case    4: return rdftPlan<2, F>;
+        case    8: return rdftPlan<3, F>;
+        case   16: return rdftPlan<4, F>;
+        case   32: return rdftPlan<5, F>;
+        case   64: return rdftPlan<6, F>;
+        case  128: return Fixed<7>::rdft;
+        case  256: return Fixed<8>::rdft;
+        case  512: return Fixed<9>::rdft;
+        case 1024: return Fixed<10>::rdft;
+    };
+
+    return nullptr;
+}
+
+// real FFT of count frames of a size fixed by the function - frame i at src + i*n, in-place if src == dst
+//   work has batchWorkSize(n) floats
+using TransformBatch = void (*)(const float * src, float * dst, int count, float * work);
+
+template <int K, void (*F)(const Plan &, const float *, float *, int, float *)>
+inline void rdftBatchPlan(const float * src, float * dst, int count, float * work) {
+    F(planLog2<K>(), src, dst, count, work);
+}
+
+// the batch of size n, nullptr if n has no plan
+template <void (*F)(const Plan &, const float *, float *, int, float *)>
+inline TransformBatch transformBatchFor(int n) {
+    switch (n) {
+        case    2: return rdftBatchPlan<1,  F>;
+        case    4: return rdftBatchPlan<2,  F>;
+        case    8: return rdftBatchPlan<3,  F>;
+        case   16: return rdftBatchPlan<4,  F>;
+        case   32: return rdftBatchPlan<5,  F>;
+        case   64: return rdftBatchPlan<6,  F>;
+        case  128: return rdftBatchPlan<7,  F>;
+        case  256: return rdftBatchPlan<8,  F>;
+        case  512: return rdftBatchPlan<9,  F>;
+        case 1024: return rdftBatchPlan<10, F>;
+    };
+
+    return nullptr;
+}
+
+// the bins [bin0, bin1) of the real FFT of a size fixed by the function, in the layout of the full transform
+//   the other bins of dst are not written. src and dst must not overlap. work has bandWorkSize(n) floats
+using TransformBand = void (*)(const float * src, float * dst, int bin0, int bin1, float * work);
+
+// the band transform is faster than the full transform if the band has at most 3/8 of the n/2 bins
+inline bool bandFaster(int n, int bin0, int bin1) {
+    bin0 = bin0 > 0 ? bin0 : 0;
+    bin1 = bin1 < n/2 ? bin1 : n/2;
+
+    return 16*(bin1 - bin0) <= 3*n;
+}
+
+#if defined(GGWAVE_SIMD_X86) || defined(GGWAVE_SIMD_NEON)
+
+// the twiddles of the band transform of n samples - see bandBins()
+//   the bins up to n/2 + kMaxLanes, so that the last bins of the band can be computed in a full vector
+inline const float * makeBandTwiddles(int n) {
+    const double kPi = 3.14159265358979323846;
+
+    float * res = (float *) malloc(sizeof(float)*16*(n/2 + kMaxLanes));
+    if (res == nullptr) {
+        return nullptr;
+    }
+
+    for (int k = 0; k < n/2 + kMaxLanes; ++k) {
+        for (int p = 0; p < kMaxLanes; ++p) {
+            res[16*k + 0 + p] = cos((2.0*kPi*p*k)/n);
+            res[16*k + 8 + p] = sin((2.0*kPi*p*k)/n);
+        }
+    }
+
+    return res;
+}
+
+template <int K>
+inline const float * bandTwiddlesLog2() {
+    static const float * res = makeBandTwiddles(1 << K);
+    return res;
+}
+
+template <int K, int L, void (*F)(const Plan &, const float *, const float *, float *, int, int, float *)>
+inline void rdftBandPlan(const float * src, float * dst, int bin0, int bin1, float * work) {
+    bin0 = bin0 > 0 ? bin0 : 0;
+    bin1 = bin1 < (1 << K)/2 ? bin1 : (1 << K)/2;
+
+    if (bin0 < bin1) {
+        F(planLog2<K - log2i(L)>(), bandTwiddlesLog2<K>(), src, dst, bin0, bin1, work);
+    }
+}
+
+// the tables are created here, so that the first transform does not allocate memory
+template <int K, int L, void (*F)(const Plan &, const float *, const float *, float *, int, int, float *)>
+inline TransformBand bandPlan() {
+    if (validPlan(planLog2<K - log2i(L)>()) == nullptr || bandTwiddlesLog2<K>() == nullptr) {
+        return nullptr;
+    }
+
+    return rdftBandPlan<K, L, F>;
+}
+
+// the band transform of size n with L lanes, nullptr if n has no plan, if n/L is too small for the lanes or if the
+// tables could not be allocated
+template <int L, void (*F)(const Plan &, const float *, const float *, float *, int, int, float *)>
+inline TransformBand transformBandFor(int n) {
+    if (n/L < (1 << kMinLog2Batch)) {
+        return nullptr;
+    }
+
+    switch (n) {
+        case   64: return bandPlan<6,  L, F>();
+        case  128: return bandPlan<7,  L, F>();
+        case  256: return bandPlan<8,  L, F>();
+        case  512: return bandPlan<9,  L, F>();
+        case 1024: return bandPlan<10, L, F>();
+    };
+
+    return nullptr;
+}
+
+#endif
+
+struct Backend {
+    const char * name;
+
+    // in-place real FFT of plan.n samples
+    void (*rdft)(const Plan & plan, float * a);
+
+    // the transform of size n - see transformFor()
+    Transform (*transform)(int n);
+
+    // the batch of size n - see transformBatchFor(). nullptr if the frames are transformed one at a time
+    TransformBatch (*transformBatch)(int n);
+
+    // the band transform of size n - see transformBandFor(). nullptr if only the full transform is available
+    TransformBand (*transformBand)(int n);
+
+    // number of frames transformed at once by a batch
+    int lanes;
+};
+
+inline void rdft_ooura(const Plan & plan, float * a) {
+    rdft(plan.n, 1, a, plan.ip, plan.w);
+}
+
+// the Ooura FFT has no size-specific kernels
+template <int K>
+struct Fixed_ooura {
+    static void rdft(float * a) {
+        rdftPlan<K, rdft_ooura>(a);
+    }
+};
+
+inline const Backend & backendOoura() {
+    static const Backend res = { "ooura", rdft_ooura, transformFor<rdft_ooura, Fixed_ooura>, nullptr, nullptr, 1 };
+    return res;
+}
+
+// the kernels are selected once, on first use
+inline const Backend & backendSIMD() {
+    static const Backend res = []() {
+        Backend b = { "scalar", rdft_scalar, transformFor<rdft_scalar, Fixed_scalar>, nullptr, nullptr, 1 };
+
+#if defined(GGWAVE_SIMD_X86)
+        b = { "sse2", rdft_sse2, transformFor<rdft_sse2, Fixed_sse2>, transformBatchFor<rdftBatch_sse2>,
+              transformBandFor<4, rdftBand_sse2>, 4 };
+
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            b = { "avx2", rdft_avx2, transformFor<rdft_avx2, Fixed_avx2>, transformBatchFor<rdftBatch_avx2>,
+                  transformBandFor<8, rdftBand_avx2>, 8 };
+        }
+#elif defined(GGWAVE_SIMD_NEON)
+        b = { "neon", rdft_neon, transformFor<rdft_neon, Fixed_neon>, transformBatchFor<rdftBatch_neon>,
+              transformBandFor<4, rdftBand_neon>, 4 };
+#endif
+
+        return b;
+    }();
+
+    return res;
+}
+
+inline const Backend & backendDefault() {
+#if defined(GGWAVE_SIMD_X86) || defined(GGWAVE_SIMD_NEON)
+    return backendSIMD();
+#else
+    return backendOoura();
+#endif
+}
+
+}
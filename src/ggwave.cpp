@@ -5,6 +5,8 @@
 #endif
 
 #include "fft.h"
+#include "fft-simd.h"
+#include "simd.h"
 #include "reed-solomon/rs.hpp"
 
 #include <math.h>
@@ -29,6 +31,27 @@
 #define GG_MIN(A, B) (((A) < (B)) ? (A) : (B))
 #define GG_MAX(A, B) (((A) >= (B)) ? (A) : (B))
 
+// used for the hand-off of the captures to the analysis executor, which can run on another thread
+#if defined(_MSC_VER)
+#include <intrin.h>
+static long ggAtomicLoad(const long * p)          { return _InterlockedCompareExchange(const_cast<long *>(p), 0, 0); }
+static void ggAtomicStore(long * p, long v)         { _InterlockedExchange(p, v); }
+static long ggAtomicFetchAdd(long * p, long v)      { return _InterlockedExchangeAdd(p, v); }
+static bool ggAtomicCAS(long * p, long e, long v)   { return _InterlockedCompareExchange(p, v, e) == e; }
+#else
+static long ggAtomicLoad(const long * p)          { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static void ggAtomicStore(long * p, long v)         { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+static long ggAtomicFetchAdd(long * p, long v)      { return __atomic_fetch_add(p, v, __ATOMIC_ACQ_REL); }
+static bool ggAtomicCAS(long * p, long e, long v)   { return __atomic_compare_exchange_n(p, &e, v, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE); }
+#endif
+
+static void ggAtomicMin(long * p, long v) {
+    long cur = ggAtomicLoad(p);
+    while (v < cur && ggAtomicCAS(p, cur, v) == false) {
+        cur = ggAtomicLoad(p);
+    }
+}
+
 //
 // C interface
 //
@@ -36,6 +59,9 @@
 namespace {
 
 FILE * g_fptr = stderr;
+
+// nullptr - fft::backendDefault()
+const fft::Backend * g_fftBackend = nullptr;
 GGWave * g_instances[GGWAVE_MAX_INSTANCES];
 
 double linear_interp(double first_number, double second_number, double fraction) {
@@ -67,7 +93,12 @@ ggwave_Instance ggwave_init(ggwave_Parameters parameters) {
                 parameters.soundMarkerThreshold,
                 parameters.sampleFormatInp,
                 parameters.sampleFormatOut,
-                parameters.operatingMode});
+                parameters.operatingMode,
+                parameters.resamplerType,
+                parameters.resamplerQuality,
+                parameters.analysisBudget,
+                parameters.analysisWorkers,
+                parameters.markerHop});
 
             return id;
         }
@@ -134,6 +165,47 @@ int ggwave_encode(
     return nBytes;
 }
 
+extern "C"
+int ggwave_nencode(
+        ggwave_Instance id,
+        const void * payloadBuffer,
+        int payloadSize,
+        ggwave_ProtocolId protocolId,
+        int volume,
+        void * waveformBuffer,
+        int waveformSize) {
+    GGWave * ggWave = (GGWave *) g_instances[id];
+
+    if (ggWave == nullptr) {
+        ggprintf("Invalid GGWave instance %d\n", id);
+        return -1;
+    }
+
+    if (ggWave->init(payloadSize, (const char *) payloadBuffer, protocolId, volume) == false) {
+        ggprintf("Failed to initialize Tx transmission for GGWave instance %d\n", id);
+        return -1;
+    }
+
+    const int nBytesRequired = ggWave->encodeSize_bytes();
+    if (waveformBuffer == nullptr || nBytesRequired > waveformSize) {
+        // the waveformBuffer is not big enough to store the waveform
+        return nBytesRequired;
+    }
+
+    if (ggWave->encodeBegin() == false) {
+        ggprintf("Failed to encode data - GGWave instance %d\n", id);
+        return -1;
+    }
+
+    const int nSamples = ggWave->encodeFrames(waveformBuffer, waveformSize/ggWave->sampleSizeOut());
+    if (nSamples <= 0 || ggWave->txHasData()) {
+        ggprintf("Failed to encode data - GGWave instance %d\n", id);
+        return -1;
+    }
+
+    return nSamples*ggWave->sampleSizeOut();
+}
+
 extern "C"
 int ggwave_decode(
         ggwave_Instance id,
@@ -248,39 +320,88 @@ uint8_t getDSSMagic(int i) {
 #endif
 }
 
-void FFT(float * f, int N, int * wi, float * wf) {
-    rdft(N, 1, f, wi, wf);
+const fft::Backend & fftBackend() {
+    return g_fftBackend ? *g_fftBackend : fft::backendDefault();
 }
 
-void FFT(const float * src, float * dst, int N, int * wi, float * wf) {
+void FFT(const float * src, float * dst, int N, fft::Transform transform) {
     memcpy(dst, src, N * sizeof(float));
 
-    FFT(dst, N, wi, wf);
+    transform(dst);
+}
+
+// count frames of N samples - frame i at src + i*N, in-place if src == dst
+//   without a batch, the frames are transformed one at a time and work is not used
+void FFTBatch(const float * src, float * dst, int N, int count, fft::Transform transform, fft::TransformBatch batch, float * work) {
+    if (batch) {
+        batch(src, dst, count, work);
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (src != dst) {
+            memcpy(dst + i*N, src + i*N, N*sizeof(float));
+        }
+        transform(dst + i*N);
+    }
+}
+
+// the bins [bin0, bin1) of the real FFT of N samples - the band transform skips the other bins, if it is faster
+void FFTBand(const float * src, float * dst, int N, int bin0, int bin1, fft::Transform transform, fft::TransformBand band, float * work) {
+    if (band && fft::bandFaster(N, bin0, bin1)) {
+        band(src, dst, bin0, bin1, work);
+        return;
+    }
+
+    FFT(src, dst, N, transform);
+}
+
+// power of the bins [bin0, bin1) of the real FFT of N samples
+//   the bins above N/2 are zero - the real FFT has only N/2 complex bins, with the Nyquist bin packed into bin 0
+void powerSpectrum(const float * fftOut, float * spectrum, int N, int bin0, int bin1) {
+    bin1 = GG_MIN(bin1, N);
+
+    const int n = GG_MIN(bin1, N/2) - bin0;
+    if (n > 0) {
+        simd::kernels().power(fftOut + 2*bin0, spectrum + bin0, n);
+    }
+
+    for (int i = GG_MAX(bin0, N/2); i < bin1; ++i) {
+        spectrum[i] = 0.0f;
+    }
 }
 
-inline void addAmplitudeSmooth(
-        const GGWave::Amplitude & src,
-        GGWave::Amplitude & dst,
-        float scalar, int startId, int finalId, int cycleMod, int nPerCycle) {
-    const int nTotal = nPerCycle*finalId;
+// linear ramp over the first and last 15% of the samples in the cycle
+void computeAmplitudeEnvelope(float * dst, int samplesPerFrame, int cycleMod, int nPerCycle) {
+    const int nTotal = nPerCycle*samplesPerFrame;
     const float frac = 0.15f;
     const float ds = frac*nTotal;
     const float ids = 1.0f/ds;
     const int nBegin = frac*nTotal;
     const int nEnd = (1.0f - frac)*nTotal;
 
-    for (int i = startId; i < finalId; i++) {
-        const float k = cycleMod*finalId + i;
+    for (int i = 0; i < samplesPerFrame; i++) {
+        const float k = cycleMod*samplesPerFrame + i;
         if (k < nBegin) {
-            dst[i] += scalar*src[i]*(k*ids);
+            dst[i] = k*ids;
         } else if (k > nEnd) {
-            dst[i] += scalar*src[i]*(((float)(nTotal) - k)*ids);
+            dst[i] = ((float)(nTotal) - k)*ids;
         } else {
-            dst[i] += scalar*src[i];
+            dst[i] = 1.0f;
         }
     }
 }
 
+// check if computeAmplitudeEnvelope() produces the envelope ramp to any sample of the frame
+bool isAmplitudeRamp(int samplesPerFrame, int cycleMod, int nPerCycle) {
+    const int nTotal = nPerCycle*samplesPerFrame;
+    const float frac = 0.15f;
+    const int nBegin = frac*nTotal;
+    const int nEnd = (1.0f - frac)*nTotal;
+
+    return cycleMod*samplesPerFrame < nBegin || cycleMod*samplesPerFrame + samplesPerFrame - 1 > nEnd;
+}
+
 int getECCBytesForLength(int len) {
     return len < 4 ? 2 : GG_MAX(4, 2*(len/5));
 }
@@ -497,9 +618,20 @@ bool GGWave::prepare(const Parameters & parameters, bool allocate) {
     m_payloadLength        = parameters.payloadLength;
     m_isRxEnabled          = parameters.operatingMode & GGWAVE_OPERATING_MODE_RX;
     m_isTxEnabled          = parameters.operatingMode & GGWAVE_OPERATING_MODE_TX;
-    m_needResampling       = m_sampleRateInp != m_sampleRate || m_sampleRateOut != m_sampleRate;
+    m_needResamplingInp    = m_sampleRateInp != m_sampleRate;
+    m_needResamplingOut    = m_sampleRateOut != m_sampleRate;
     m_txOnlyTones          = parameters.operatingMode & GGWAVE_OPERATING_MODE_TX_ONLY_TONES;
     m_isDSSEnabled         = parameters.operatingMode & GGWAVE_OPERATING_MODE_USE_DSS;
+    m_txStreaming          = parameters.operatingMode & GGWAVE_OPERATING_MODE_TX_STREAMING;
+    m_txSymbolCache        = parameters.operatingMode & GGWAVE_OPERATING_MODE_TX_SYMBOL_CACHE;
+    m_txNCO                = parameters.operatingMode & GGWAVE_OPERATING_MODE_TX_NCO;
+    m_rxAnalysisCache      = parameters.operatingMode & GGWAVE_OPERATING_MODE_RX_ANALYSIS_CACHE;
+    m_rxAsyncAnalysis      = parameters.operatingMode & GGWAVE_OPERATING_MODE_RX_ASYNC_ANALYSIS;
+    m_rxEnergyGate         = parameters.operatingMode & GGWAVE_OPERATING_MODE_RX_ENERGY_GATE;
+    m_rxRecordI16          = parameters.operatingMode & GGWAVE_OPERATING_MODE_RX_RECORD_I16;
+    m_rxAnalysisWorkers    = GG_MAX(1, parameters.analysisWorkers);
+    m_rxMarkerHop          = parameters.markerHop > 0 ? parameters.markerHop : kMaxSpectrumHistory;
+    m_rxAnalysisBudget     = m_rxAsyncAnalysis || m_rxAnalysisWorkers > 1 ? 0 : parameters.analysisBudget;
 
     if (m_sampleSizeInp == 0) {
         ggprintf("Invalid or unsupported capture sample format: %d\n", (int) parameters.sampleFormatInp);
@@ -516,6 +648,25 @@ bool GGWave::prepare(const Parameters & parameters, bool allocate) {
         return false;
     }
 
+    // the FFT plans are created here, so that the decoding does not allocate memory
+    if (m_isRxEnabled && fft::plan(parameters.samplesPerFrame) == nullptr) {
+        if (parameters.samplesPerFrame < 2 || (parameters.samplesPerFrame & (parameters.samplesPerFrame - 1)) != 0) {
+            ggprintf("Invalid samples per frame: %d, must be a power of 2\n", parameters.samplesPerFrame);
+        } else {
+            ggprintf("Failed to allocate the FFT tables for %d samples per frame\n", parameters.samplesPerFrame);
+        }
+        return false;
+    }
+
+    m_fft = m_isRxEnabled ? fftBackend().transform(parameters.samplesPerFrame) : nullptr;
+
+    m_fftBatch       = m_isRxEnabled && fftBackend().transformBatch ? fftBackend().transformBatch(parameters.samplesPerFrame) : nullptr;
+    m_fftBatchFrames = m_fftBatch ? fftBackend().lanes : 1;
+
+    // the band transform is used while the enabled Rx protocols cover a narrow band - initially Protocols::rx(), then
+    // rxProtocols() of the instance. Its tables are created here, so that the decoding does not allocate memory
+    m_fftBand = m_isRxEnabled && fftBackend().transformBand ? fftBackend().transformBand(parameters.samplesPerFrame) : nullptr;
+
     if (m_sampleRateInp < kSampleRateMin) {
         ggprintf("Error: capture sample rate (%g Hz) must be >= %g Hz\n", m_sampleRateInp, kSampleRateMin);
         return false;
@@ -526,6 +677,36 @@ bool GGWave::prepare(const Parameters & parameters, bool allocate) {
         return false;
     }
 
+    if (parameters.resamplerType != GGWAVE_RESAMPLER_SINC &&
+        parameters.resamplerType != GGWAVE_RESAMPLER_POLYPHASE) {
+        ggprintf("Invalid resampler type: %d\n", (int) parameters.resamplerType);
+        return false;
+    }
+
+    if (parameters.resamplerType == GGWAVE_RESAMPLER_POLYPHASE &&
+        (parameters.resamplerQuality < 1 || parameters.resamplerQuality > Resampler::kMaxQuality)) {
+        ggprintf("Invalid resampler quality: %d, must be in [1, %d]\n", parameters.resamplerQuality, Resampler::kMaxQuality);
+        return false;
+    }
+
+    if (parameters.analysisBudget < 0) {
+        ggprintf("Invalid analysis budget: %d\n", parameters.analysisBudget);
+        return false;
+    }
+
+    if (parameters.analysisWorkers < 0 || parameters.analysisWorkers > kMaxAnalysisWorkers) {
+        ggprintf("Invalid number of analysis workers: %d, max: %d\n", parameters.analysisWorkers, kMaxAnalysisWorkers);
+        return false;
+    }
+
+    if (parameters.markerHop < 0 || parameters.markerHop > kMaxSpectrumHistory || (parameters.markerHop > 0 && kMaxSpectrumHistory % parameters.markerHop != 0)) {
+        ggprintf("Invalid marker hop: %d, must divide %d\n", parameters.markerHop, kMaxSpectrumHistory);
+        return false;
+    }
+
+    m_rx.resampler.configure(parameters.resamplerType, parameters.resamplerQuality);
+    m_tx.resampler.configure(parameters.resamplerType, parameters.resamplerQuality);
+
     // memory allocation:
 
     m_heap = nullptr;
@@ -558,17 +739,28 @@ bool GGWave::prepare(const Parameters & parameters, bool allocate) {
     if (m_isRxEnabled) {
         m_rx.samplesNeeded = m_samplesPerFrame;
 
-        m_rx.fftWorkI[0] = 0;
-
         m_rx.protocol   = {};
         m_rx.protocolId = GGWAVE_PROTOCOL_COUNT;
         m_rx.protocols  = Protocols::rx();
-
-        m_rx.minFreqStart = minFreqStart(m_rx.protocols);
     }
 
     if (m_isTxEnabled) {
         m_tx.protocols = Protocols::tx();
+
+        m_tx.toneTables.freqStart       = -1;
+        m_tx.toneTables.bytesPerTx      = -1;
+        m_tx.toneTables.sampleRate      = -1.0f;
+        m_tx.toneTables.samplesPerFrame = -1;
+        m_tx.toneTablesShared           = nullptr;
+
+        m_tx.toneSymbols.freqStart      = -1;
+        m_tx.toneSymbols.framesPerTx    = -1;
+        m_tx.toneSymbols.bytesPerTx     = -1;
+        m_tx.toneSymbols.volume         = -1.0f;
+        m_tx.toneSymbols.nTones         = 2*16*maxBytesPerTx(m_tx.protocols);
+
+        m_tx.envelopeCycleMod           = -1;
+        m_tx.envelopeNPerCycle          = -1;
     }
 
     return init("", {}, 0);
@@ -577,7 +769,8 @@ bool GGWave::prepare(const Parameters & parameters, bool allocate) {
 bool GGWave::alloc(void * p, int & n) {
     const int maxLength   = m_isFixedPayloadLength ? m_payloadLength : kMaxLengthVariable;
     const int totalLength = maxLength + getECCBytesForLength(maxLength);
-    const int totalTxs    = (totalLength + minBytesPerTx(Protocols::rx()) - 1)/minBytesPerTx(Protocols::tx());
+    const int totalTxsRx  = (totalLength + minBytesPerTx(Protocols::rx()) - 1)/minBytesPerTx(Protocols::rx());
+    const int totalTxsTx  = (totalLength + minBytesPerTx(Protocols::tx()) - 1)/minBytesPerTx(Protocols::tx());
 
     if (totalLength > kMaxDataSize) {
         ggprintf("Error: total length %d (payload %d + ECC %d bytes) is too large ( > %d)\n",
@@ -585,20 +778,22 @@ bool GGWave::alloc(void * p, int & n) {
         return false;
     }
 
-    // common
-    ::ggalloc(m_dataEncoded, totalLength + m_encodedDataOffset, p, n);
-
     if (m_isRxEnabled) {
+        ::ggalloc(m_rx.dataEncoded, totalLength + m_encodedDataOffset, p, n);
+
         ::ggalloc(m_rx.fftOut,   2*m_samplesPerFrame, p, n);
-        ::ggalloc(m_rx.fftWorkI, 3 + sqrt(m_samplesPerFrame/2), p, n);
-        ::ggalloc(m_rx.fftWorkF, m_samplesPerFrame/2, p, n);
+        if (m_fftBand) {
+            ::ggalloc(m_rx.fftWork, fft::bandWorkSize(m_samplesPerFrame), p, n);
+        }
 
         ::ggalloc(m_rx.spectrum,           m_samplesPerFrame, p, n);
         // small extra space because sometimes resampling needs a few more samples:
-        ::ggalloc(m_rx.amplitude,          m_needResampling ? m_samplesPerFrame + 128 : m_samplesPerFrame, p, n);
+        const int frameSlack = m_needResamplingInp ? 128 : 0;
+        ::ggalloc(m_rx.amplitudeBuffer,    m_samplesPerFrame + frameSlack, p, n);
+        m_rx.amplitude.assign(m_rx.amplitudeBuffer);
         // min input sampling rate is 0.125*m_sampleRate:
-        ::ggalloc(m_rx.amplitudeResampled, m_needResampling ? 8*m_samplesPerFrame : m_samplesPerFrame, p, n);
-        ::ggalloc(m_rx.amplitudeTmp,       m_needResampling ? 8*m_samplesPerFrame*m_sampleSizeInp : m_samplesPerFrame*m_sampleSizeInp, p, n);
+        ::ggalloc(m_rx.amplitudeResampled, m_needResamplingInp ? 8*m_samplesPerFrame : m_samplesPerFrame, p, n);
+        ::ggalloc(m_rx.amplitudeTmp,       m_needResamplingInp ? 8*m_samplesPerFrame*m_sampleSizeInp : m_samplesPerFrame*m_sampleSizeInp, p, n);
 
         ::ggalloc(m_rx.data, maxLength + 1, p, n); // extra byte for null-termination
 
@@ -608,14 +803,45 @@ bool GGWave::alloc(void * p, int & n) {
                 return false;
             }
 
-            ::ggalloc(m_rx.spectrumHistoryFixed, totalTxs*maxFramesPerTx(Protocols::rx(), false), m_samplesPerFrame, p, n);
-            ::ggalloc(m_rx.detectedBins,         2*totalLength, p, n);
-            ::ggalloc(m_rx.detectedTones,        2*16*maxBytesPerTx(Protocols::rx()), p, n);
+            // mono-tone protocols use two Txs per chunk
+            m_rx.nTonesFixed = 2*maxBytesPerTx(Protocols::rx());
+            m_rx.nTxsFixed   = 2*totalTxsRx;
+
+            ::ggalloc(m_rx.spectrumHistoryFixed, totalTxsRx*maxFramesPerTx(Protocols::rx(), false), m_samplesPerFrame, p, n);
+            ::ggalloc(m_rx.tonesFixed,           totalTxsRx*maxFramesPerTx(Protocols::rx(), false), GGWAVE_PROTOCOL_COUNT*m_rx.nTonesFixed, p, n);
+            ::ggalloc(m_rx.votesFixed,           GGWAVE_PROTOCOL_COUNT, 16*m_rx.nTxsFixed*m_rx.nTonesFixed, p, n);
+            ::ggalloc(m_rx.majorityFixed,        GGWAVE_PROTOCOL_COUNT, m_rx.nTxsFixed*m_rx.nTonesFixed, p, n);
+            ::ggalloc(m_rx.detectedFixed,        GGWAVE_PROTOCOL_COUNT, p, n);
+            ::ggalloc(m_rx.votesFixedProtocol,   GGWAVE_PROTOCOL_COUNT, p, n);
         } else {
             // variable payload length
-            ::ggalloc(m_rx.amplitudeRecorded, kMaxRecordedFrames*m_samplesPerFrame, p, n);
+            // the analysis reads up to one Tx past the end of the recording
+            m_rx.recordedFrames = maxRecvDurationFrames(Protocols::rx()) + maxFramesPerTx(Protocols::rx(), false);
+
+            // the float recording is also the target of the incoming frames, so it needs the same slack after the last one
+            if (m_rxRecordI16) {
+                ::ggalloc(m_rx.amplitudeRecordedI16, m_rx.recordedFrames*m_samplesPerFrame, p, n);
+            } else {
+                ::ggalloc(m_rx.amplitudeRecorded,    m_rx.recordedFrames*m_samplesPerFrame + frameSlack, p, n);
+            }
             ::ggalloc(m_rx.amplitudeAverage,  m_samplesPerFrame, p, n);
+            ::ggalloc(m_rx.amplitudeSum,      m_samplesPerFrame, p, n);
             ::ggalloc(m_rx.amplitudeHistory,  kMaxSpectrumHistory, m_samplesPerFrame, p, n);
+            ::ggalloc(m_rx.markerDFT,         4*2*m_nBitsInMarker, p, n);
+            ::ggalloc(m_rx.markerScore,       m_nMarkerFrames*kAnalysisStepsPerFrame, p, n);
+            ::ggalloc(m_rx.markerBins,          GGWAVE_PROTOCOL_COUNT*m_nBitsInMarker, p, n);
+            ::ggalloc(m_rx.markerBinsFreqStart, GGWAVE_PROTOCOL_COUNT, p, n);
+            if (m_rxEnergyGate) {
+                ::ggalloc(m_rx.energyGateFloor,    GGWAVE_PROTOCOL_COUNT, p, n);
+                ::ggalloc(m_rx.energyGateMeasured, GGWAVE_PROTOCOL_COUNT, p, n);
+            }
+            if (m_rxAnalysisCache) {
+                m_rx.analysisCacheNBins = 2*16*maxBytesPerTx(Protocols::rx());
+
+                ::ggalloc(m_rx.analysisCacheOffsets, kAnalysisCacheFrames*kAnalysisStepsPerFrame, p, n);
+                ::ggalloc(m_rx.analysisCacheSpectra, kAnalysisCacheFrames*kAnalysisStepsPerFrame, 2*m_rx.analysisCacheNBins, p, n);
+                ::ggalloc(m_rx.analysisCacheWork,    m_fftBatchFrames*m_samplesPerFrame, p, n);
+            }
         }
     }
 
@@ -623,20 +849,36 @@ bool GGWave::alloc(void * p, int & n) {
         const int maxDataBits = 2*16*maxBytesPerTx(Protocols::tx());
 
         if (m_txOnlyTones == false) {
-            ::ggalloc(m_tx.phaseOffsets,    maxDataBits, p, n);
-            ::ggalloc(m_tx.bit0Amplitude,   maxDataBits, m_samplesPerFrame, p, n);
-            ::ggalloc(m_tx.bit1Amplitude,   maxDataBits, m_samplesPerFrame, p, n);
-            ::ggalloc(m_tx.output,          m_samplesPerFrame, p, n);
-            ::ggalloc(m_tx.outputResampled, 2*m_samplesPerFrame, p, n);
-            ::ggalloc(m_tx.outputTmp,       kMaxRecordedFrames*m_samplesPerFrame*m_sampleSizeOut, p, n);
-            ::ggalloc(m_tx.outputI16,       kMaxRecordedFrames*m_samplesPerFrame, p, n);
+            ::ggalloc(m_tx.toneTables.phaseOffsets,  maxDataBits, p, n);
+            if (m_txNCO) {
+                ::ggalloc(m_tx.toneTables.oscCoeff,  maxDataBits, p, n);
+                ::ggalloc(m_tx.toneTables.oscInit,   2*kOscLanes*maxDataBits, p, n);
+                ::ggalloc(m_tx.tone,                 m_samplesPerFrame, p, n);
+            } else {
+                ::ggalloc(m_tx.toneTables.bit0Amplitude, maxDataBits, m_samplesPerFrame, p, n);
+                ::ggalloc(m_tx.toneTables.bit1Amplitude, maxDataBits, m_samplesPerFrame, p, n);
+            }
+            ::ggalloc(m_tx.envelope,                 m_samplesPerFrame, p, n);
+            ::ggalloc(m_tx.output,                   m_samplesPerFrame, p, n);
+            // note : after the first frame, the resampler can produce at most 1 extra sample per frame
+            ::ggalloc(m_tx.outputResampled,          m_needResamplingOut ? Resampler::nSamplesOutTotal(m_sampleRate/m_sampleRateOut, m_samplesPerFrame) + 1 : m_samplesPerFrame, p, n);
+            if (m_txStreaming == false) {
+                ::ggalloc(m_tx.outputTmp,            kMaxRecordedFrames*m_samplesPerFrame*m_sampleSizeOut, p, n);
+                ::ggalloc(m_tx.outputI16,            kMaxRecordedFrames*m_samplesPerFrame, p, n);
+            }
+            if (m_txSymbolCache) {
+                ::ggalloc(m_tx.toneSymbols.envelopeClass, maxFramesPerTx(Protocols::tx(), false), p, n);
+                ::ggalloc(m_tx.toneSymbols.tones,         maxEnvelopeClasses(Protocols::tx())*maxDataBits, m_samplesPerFrame, p, n);
+                ::ggalloc(m_tx.toneSymbols.markers,       2*m_nMarkerFrames, m_samplesPerFrame, p, n);
+            }
         }
 
         const int maxTones    = m_isFixedPayloadLength ? maxTonesPerTx(Protocols::tx()) : m_nBitsInMarker;
 
-        ::ggalloc(m_tx.data,     maxLength + 1, p, n); // first byte stores the length
-        ::ggalloc(m_tx.dataBits, maxDataBits, p, n);
-        ::ggalloc(m_tx.tones,    maxTones*totalTxs + (maxTones > 1 ? totalTxs : 0), p, n);
+        ::ggalloc(m_tx.data,        maxLength + 1, p, n); // first byte stores the length
+        ::ggalloc(m_tx.dataEncoded, totalLength + m_encodedDataOffset, p, n);
+        ::ggalloc(m_tx.dataBits,    maxDataBits, p, n);
+        ::ggalloc(m_tx.tones,       maxTones*totalTxsTx + (maxTones > 1 ? totalTxsTx : 0), p, n);
     }
 
     // pre-allocate Reed-Solomon memory buffers
@@ -649,8 +891,61 @@ bool GGWave::alloc(void * p, int & n) {
         ::ggalloc(m_workRSData, RS::ReedSolomon::getWorkSize_bytes(maxLength, getECCBytesForLength(maxLength)), p, n);
     }
 
-    if (m_needResampling) {
-        m_resampler.alloc(p, n);
+    // the analysis of variable-length captures has its own buffers only if it runs on the executor
+    // each additional parallel worker always has its own buffers
+    if (m_isRxEnabled && m_isFixedPayloadLength == false) {
+        auto & analysis = m_rx.analysis;
+
+        if (m_rxAsyncAnalysis) {
+            if (m_rxRecordI16) {
+                ::ggalloc(analysis.amplitudeRecordedI16, m_rx.recordedFrames*m_samplesPerFrame, p, n);
+            } else {
+                ::ggalloc(analysis.amplitudeRecorded,    m_rx.recordedFrames*m_samplesPerFrame + (m_needResamplingInp ? 128 : 0), p, n);
+            }
+        } else {
+            analysis.amplitudeRecorded.assign(m_rx.amplitudeRecorded);
+            analysis.amplitudeRecordedI16.assign(m_rx.amplitudeRecordedI16);
+        }
+
+        for (int i = 0; i < m_rxAnalysisWorkers; ++i) {
+            auto & worker = analysis.workers[i];
+
+            if (i == 0 && m_rxAsyncAnalysis == false) {
+                worker.fftOut.assign(m_rx.fftOut);
+                worker.spectrum.assign(m_rx.spectrum);
+                worker.dataEncoded.assign(m_rx.dataEncoded);
+                worker.data.assign(m_rx.data);
+                worker.workRSLength.assign(m_workRSLength);
+                worker.workRSData.assign(m_workRSData);
+            } else {
+                ::ggalloc(worker.fftOut,       2*m_samplesPerFrame, p, n);
+                ::ggalloc(worker.spectrum,     m_samplesPerFrame, p, n);
+                ::ggalloc(worker.dataEncoded,  totalLength + m_encodedDataOffset, p, n);
+                ::ggalloc(worker.data,         maxLength + 1, p, n);
+                ::ggalloc(worker.workRSLength, RS::ReedSolomon::getWorkSize_bytes(1, m_encodedDataOffset - 1), p, n);
+                ::ggalloc(worker.workRSData,   RS::ReedSolomon::getWorkSize_bytes(maxLength, getECCBytesForLength(maxLength)), p, n);
+            }
+
+            if (m_fftBatchFrames > 1) {
+                ::ggalloc(worker.fftBatch, m_fftBatchFrames*m_samplesPerFrame, p, n);
+                ::ggalloc(worker.fftWork,  fft::batchWorkSize(m_samplesPerFrame), p, n);
+            } else {
+                worker.fftBatch.assign(worker.fftOut);
+            }
+        }
+
+        if (m_rxAnalysisWorkers > 1) {
+            ::ggalloc(analysis.candidates, GGWAVE_PROTOCOL_COUNT*m_nMarkerFrames*kAnalysisStepsPerFrame, p, n);
+        }
+    }
+
+    // separate resampler state for each direction, so that Rx and Tx do not interfere in full-duplex mode
+    if (m_isRxEnabled && m_needResamplingInp) {
+        m_rx.resampler.alloc(p, n);
+    }
+
+    if (m_isTxEnabled && m_txOnlyTones == false && m_needResamplingOut) {
+        m_tx.resampler.alloc(p, n);
     }
 
     return true;
@@ -660,6 +955,18 @@ void GGWave::setLogFile(FILE * fptr) {
     g_fptr = fptr;
 }
 
+void GGWave::setFFTBackend(FFTBackend backend) {
+    switch (backend) {
+        case GGWAVE_FFT_BACKEND_DEFAULT: g_fftBackend = nullptr;               break;
+        case GGWAVE_FFT_BACKEND_OOURA:   g_fftBackend = &fft::backendOoura(); break;
+        case GGWAVE_FFT_BACKEND_SIMD:    g_fftBackend = &fft::backendSIMD();  break;
+    };
+}
+
+const char * GGWave::fftBackendName() {
+    return fftBackend().name;
+}
+
 const GGWave::Parameters & GGWave::getDefaultParameters() {
     static ggwave_Parameters result {
         -1, // vaiable payload length
@@ -671,6 +978,11 @@ const GGWave::Parameters & GGWave::getDefaultParameters() {
         GGWAVE_SAMPLE_FORMAT_F32,
         GGWAVE_SAMPLE_FORMAT_F32,
         GGWAVE_OPERATING_MODE_RX | GGWAVE_OPERATING_MODE_TX,
+        GGWAVE_RESAMPLER_POLYPHASE,
+        kDefaultResamplerQuality,
+        0, // no analysis budget
+        0, // sequential analysis
+        0, // check for markers every kMaxSpectrumHistory frames
     };
 
     return result;
@@ -701,8 +1013,10 @@ bool GGWave::init(int dataSize, const char * dataBuffer, TxProtocolId protocolId
         }
 
         m_tx.hasData = false;
+        m_tx.encoding = false;
+        m_tx.samplesPending = 0;
         m_tx.data.zero();
-        m_dataEncoded.zero();
+        m_tx.dataEncoded.zero();
 
         if (dataSize > 0) {
             if (protocolId < 0 || protocolId >= m_tx.protocols.size()) {
@@ -745,20 +1059,42 @@ bool GGWave::init(int dataSize, const char * dataBuffer, TxProtocolId protocolId
     // Rx
     if (m_isRxEnabled) {
         m_rx.receiving = false;
-        m_rx.analyzing = false;
+        m_rx.captureReady = false;
+
+        // an analysis on the executor is not interrupted - RX_AND_TX instances call init() to transmit
+        if (m_rxAsyncAnalysis == false) {
+            m_rx.analyzing = false;
+            m_rx.analysis.started = false;
+
+            m_rx.framesToAnalyze = 0;
+            m_rx.framesLeftToAnalyze = 0;
+        }
 
-        m_rx.framesToAnalyze = 0;
-        m_rx.framesLeftToAnalyze = 0;
         m_rx.framesToRecord = 0;
         m_rx.framesLeftToRecord = 0;
 
         m_rx.spectrum.zero();
+        m_rx.amplitude.assign(m_rx.amplitudeBuffer);
         m_rx.amplitude.zero();
         m_rx.amplitudeHistory.zero();
+        m_rx.amplitudeSumValid = false;
 
         m_rx.data.zero();
 
         m_rx.spectrumHistoryFixed.zero();
+
+        for (int i = 0; i < (int) m_rx.votesFixedProtocol.size(); ++i) {
+            m_rx.votesFixedProtocol[i].enabled = false;
+        }
+
+        for (int i = 0; i < (int) m_rx.markerBinsFreqStart.size(); ++i) {
+            m_rx.markerBinsFreqStart[i] = -1;
+        }
+
+        if (m_rxEnergyGate) {
+            m_rx.energyGateFloor.zero();
+            m_rx.energyGateMeasured.zero();
+        }
     }
 
     return true;
@@ -773,31 +1109,65 @@ uint32_t GGWave::encodeSize_samples() const {
         return 0;
     }
 
-    float factor = 1.0f;
-    int samplesPerFrameOut = m_samplesPerFrame;
-    if (m_needResampling) {
-        factor = m_sampleRate/m_sampleRateOut;
-        // note : +1 extra sample in order to overestimate the buffer size
-        samplesPerFrameOut = m_resampler.resample(factor, m_samplesPerFrame, m_tx.output.data(), nullptr) + 1;
-    }
     const int nECCBytesPerTx = getECCBytesForLength(m_tx.dataLength);
     const int sendDataLength = m_tx.dataLength + m_encodedDataOffset;
     const int totalBytes = sendDataLength + nECCBytesPerTx;
     const int totalDataFrames = m_tx.protocol.extra*((totalBytes + m_tx.protocol.bytesPerTx - 1)/m_tx.protocol.bytesPerTx)*m_tx.protocol.framesPerTx;
 
-    return (
-            m_nMarkerFrames + totalDataFrames + m_nMarkerFrames
-           )*samplesPerFrameOut;
+    const int nSamples = (m_nMarkerFrames + totalDataFrames + m_nMarkerFrames)*m_samplesPerFrame;
+
+    if (m_needResamplingOut) {
+        return Resampler::nSamplesOutTotal(m_sampleRate/m_sampleRateOut, nSamples);
+    }
+
+    return nSamples;
 }
 
 uint32_t GGWave::encode() {
+    if (m_txStreaming) {
+        ggprintf("Tx streaming is enabled - use encodeBegin() and encodeFrames() to generate the waveform\n");
+        return 0;
+    }
+
+    if (encodeBegin() == false) {
+        return 0;
+    }
+
+    if (m_txOnlyTones) {
+        return true;
+    }
+
+    uint32_t offset = 0;
+
+    while (m_tx.encoding) {
+        const int samplesPerFrameOut = encodeFrame();
+
+        // default output is in 16-bit signed int so we always compute it
+        encodeConvert(m_tx.outputResampled.data(), m_tx.outputI16.data() + offset, samplesPerFrameOut, GGWAVE_SAMPLE_FORMAT_I16);
+
+        // for 16-bit signed int output we already have the data in m_tx.outputI16
+        if (m_sampleFormatOut != GGWAVE_SAMPLE_FORMAT_I16) {
+            encodeConvert(m_tx.outputResampled.data(), m_tx.outputTmp.data() + offset*m_sampleSizeOut, samplesPerFrameOut, m_sampleFormatOut);
+        }
+
+        offset += samplesPerFrameOut;
+    }
+
+    m_tx.lastAmplitudeSize = offset;
+
+    // the encoded waveform can be accessed via the txWaveform() method
+    // we return the size of the waveform in bytes:
+    return offset*m_sampleSizeOut;
+}
+
+bool GGWave::encodeBegin() {
     if (m_isTxEnabled == false) {
         ggprintf("Tx is disabled - cannot transmit data with this GGWave instance\n");
-        return 0;
+        return false;
     }
 
-    if (m_needResampling) {
-        m_resampler.reset();
+    if (m_needResamplingOut) {
+        m_tx.resampler.reset();
     }
 
     const int nECCBytesPerTx = getECCBytesForLength(m_tx.dataLength);
@@ -807,12 +1177,18 @@ uint32_t GGWave::encode() {
 
     if (m_isFixedPayloadLength == false) {
         RS::ReedSolomon rsLength(1, m_encodedDataOffset - 1, m_workRSLength.data());
-        rsLength.Encode(m_tx.data.data(), m_dataEncoded.data());
+        rsLength.Encode(m_tx.data.data(), m_tx.dataEncoded.data());
     }
 
     // first byte of m_tx.data contains the length of the payload, so we skip it:
     RS::ReedSolomon rsData = RS::ReedSolomon(m_tx.dataLength, nECCBytesPerTx, m_workRSData.data());
-    rsData.Encode(m_tx.data.data() + 1, m_dataEncoded.data() + m_encodedDataOffset);
+    rsData.Encode(m_tx.data.data() + 1, m_tx.dataEncoded.data() + m_encodedDataOffset);
+
+    m_tx.encoding        = false;
+    m_tx.frameId         = 0;
+    m_tx.totalDataFrames = totalDataFrames;
+    m_tx.samplesPending  = 0;
+    m_tx.samplesOffset   = 0;
 
     // generate tones
     {
@@ -835,19 +1211,19 @@ uint32_t GGWave::encode() {
                 for (int j = 0; j < m_tx.protocol.bytesPerTx; ++j) {
                     if (m_tx.protocol.extra == 1) {
                         {
-                            uint8_t d = m_dataEncoded[dataOffset + j] & 15;
+                            uint8_t d = m_tx.dataEncoded[dataOffset + j] & 15;
                             m_tx.dataBits[(2*j + 0)*16 + d] = 1;
                         }
                         {
-                            uint8_t d = m_dataEncoded[dataOffset + j] & 240;
+                            uint8_t d = m_tx.dataEncoded[dataOffset + j] & 240;
                             m_tx.dataBits[(2*j + 1)*16 + (d >> 4)] = 1;
                         }
                     } else {
                         if (dataOffset % m_tx.protocol.extra == 0) {
-                            uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 15;
+                            uint8_t d = m_tx.dataEncoded[dataOffset/m_tx.protocol.extra + j] & 15;
                             m_tx.dataBits[(2*j + 0)*16 + d] = 1;
                         } else {
-                            uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 240;
+                            uint8_t d = m_tx.dataEncoded[dataOffset/m_tx.protocol.extra + j] & 240;
                             m_tx.dataBits[(2*j + 0)*16 + (d >> 4)] = 1;
                         }
                     }
@@ -880,178 +1256,174 @@ uint32_t GGWave::encode() {
         }
     }
 
-    // compute Tx data
-    {
-        for (int k = 0; k < (int) m_tx.phaseOffsets.size(); ++k) {
-            m_tx.phaseOffsets[k] = (M_PI*k)/(m_tx.protocol.nDataBitsPerTx());
+    if (m_tx.hasData) {
+        txUpdateToneTables();
+
+        if (m_txSymbolCache) {
+            txUpdateToneSymbols();
         }
+    }
 
-        // note : what is the purpose of this shuffle ? I forgot .. :(
-        //std::random_device rd;
-        //std::mt19937 g(rd());
+    m_tx.encoding = m_tx.hasData;
 
-        //std::shuffle(phaseOffsets.begin(), phaseOffsets.end(), g);
+    return true;
+}
 
-        for (int k = 0; k < (int) m_tx.dataBits.size(); ++k) {
-            const double freq = bitFreq(m_tx.protocol, k);
+int GGWave::encodeFrames(void * dst, int maxSamples) {
+    if (m_isTxEnabled == false || m_txOnlyTones) {
+        ggprintf("Waveform generation is disabled for this GGWave instance\n");
+        return -1;
+    }
 
-            const double phaseOffset = m_tx.phaseOffsets[k];
-            const double curHzPerSample = m_hzPerSample;
-            const double curIHzPerSample = 1.0/curHzPerSample;
+    if (dst == nullptr || maxSamples < 0) {
+        ggprintf("Invalid output buffer: %p, max samples: %d\n", dst, maxSamples);
+        return -1;
+    }
 
-            for (int i = 0; i < m_samplesPerFrame; i++) {
-                const double curi = i;
-                m_tx.bit1Amplitude[k][i] = sin((2.0*M_PI)*(curi*m_isamplesPerFrame)*(freq*curIHzPerSample) + phaseOffset);
-            }
+    auto p = reinterpret_cast<uint8_t *>(dst);
 
-            for (int i = 0; i < m_samplesPerFrame; i++) {
-                const double curi = i;
-                m_tx.bit0Amplitude[k][i] = sin((2.0*M_PI)*(curi*m_isamplesPerFrame)*((freq + m_hzPerSample*m_freqDelta_bin)*curIHzPerSample) + phaseOffset);
-            }
+    int nWritten = 0;
+    while (nWritten < maxSamples) {
+        while (m_tx.samplesPending == 0 && m_tx.encoding) {
+            m_tx.samplesPending = encodeFrame();
+            m_tx.samplesOffset  = 0;
+        }
+
+        if (m_tx.samplesPending == 0) {
+            break;
         }
+
+        const int n = GG_MIN(maxSamples - nWritten, m_tx.samplesPending);
+        encodeConvert(m_tx.outputResampled.data() + m_tx.samplesOffset, p + nWritten*m_sampleSizeOut, n, m_sampleFormatOut);
+
+        nWritten += n;
+        m_tx.samplesOffset  += n;
+        m_tx.samplesPending -= n;
     }
 
-    int frameId = 0;
-    uint32_t offset = 0;
+    return nWritten;
+}
+
+int GGWave::encodeFrame() {
+    if (m_tx.encoding == false) {
+        return 0;
+    }
+
+    const int frameId = m_tx.frameId;
+    const int totalDataFrames = m_tx.totalDataFrames;
     const float factor = m_sampleRate/m_sampleRateOut;
 
-    while (m_tx.hasData) {
-        m_tx.output.zero();
+    m_tx.output.zero();
 
-        uint16_t nFreq = 0;
-        if (frameId < m_nMarkerFrames) {
-            nFreq = m_nBitsInMarker;
+    const auto & kernels = simd::kernels();
 
-            for (int i = 0; i < m_nBitsInMarker; ++i) {
-                if (i%2 == 0) {
-                    ::addAmplitudeSmooth(m_tx.bit1Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, frameId, m_nMarkerFrames);
-                } else {
-                    ::addAmplitudeSmooth(m_tx.bit0Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, frameId, m_nMarkerFrames);
-                }
-            }
-        } else if (frameId < m_nMarkerFrames + totalDataFrames) {
-            int dataOffset = frameId - m_nMarkerFrames;
-            int cycleModMain = dataOffset%m_tx.protocol.framesPerTx;
-            dataOffset /= m_tx.protocol.framesPerTx;
-            dataOffset *= m_tx.protocol.bytesPerTx;
+    auto & symbols = m_tx.toneSymbols;
 
-            m_tx.dataBits.zero();
+    uint16_t nFreq = 0;
+    if (m_txSymbolCache && (frameId < m_nMarkerFrames || frameId >= m_nMarkerFrames + totalDataFrames)) {
+        const int markerId = frameId < m_nMarkerFrames ? frameId : frameId - totalDataFrames;
+        if (markerId >= 2*m_nMarkerFrames) {
+            m_tx.hasData  = false;
+            m_tx.encoding = false;
+            return 0;
+        }
 
-            for (int j = 0; j < m_tx.protocol.bytesPerTx; ++j) {
-                if (m_tx.protocol.extra == 1) {
-                    {
-                        uint8_t d = m_dataEncoded[dataOffset + j] & 15;
-                        m_tx.dataBits[(2*j + 0)*16 + d] = 1;
-                    }
-                    {
-                        uint8_t d = m_dataEncoded[dataOffset + j] & 240;
-                        m_tx.dataBits[(2*j + 1)*16 + (d >> 4)] = 1;
-                    }
-                } else {
-                    if (dataOffset % m_tx.protocol.extra == 0) {
-                        uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 15;
-                        m_tx.dataBits[(2*j + 0)*16 + d] = 1;
-                    } else {
-                        uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 240;
-                        m_tx.dataBits[(2*j + 0)*16 + (d >> 4)] = 1;
-                    }
-                }
-            }
+        // the precomputed marker frames are already scaled
+        m_tx.output.copy(symbols.markers[markerId]);
+    } else if (frameId < m_nMarkerFrames) {
+        nFreq = m_nBitsInMarker;
 
-            for (int k = 0; k < 2*m_tx.protocol.bytesPerTx*16; ++k) {
-                if (m_tx.dataBits[k] == 0) continue;
+        const float * envelope = txEnvelope(frameId, m_nMarkerFrames);
+        for (int i = 0; i < m_nBitsInMarker; ++i) {
+            kernels.accumulate(m_tx.output.data(), txTone(2*i + i%2).data(), m_tx.sendVolume, envelope, m_samplesPerFrame);
+        }
+    } else if (frameId < m_nMarkerFrames + totalDataFrames) {
+        int dataOffset = frameId - m_nMarkerFrames;
+        int cycleModMain = dataOffset%m_tx.protocol.framesPerTx;
+        dataOffset /= m_tx.protocol.framesPerTx;
+        dataOffset *= m_tx.protocol.bytesPerTx;
 
-                ++nFreq;
-                if (k%2) {
-                    ::addAmplitudeSmooth(m_tx.bit0Amplitude[k/2], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, cycleModMain, m_tx.protocol.framesPerTx);
-                } else {
-                    ::addAmplitudeSmooth(m_tx.bit1Amplitude[k/2], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, cycleModMain, m_tx.protocol.framesPerTx);
-                }
-            }
-        } else if (frameId < m_nMarkerFrames + totalDataFrames + m_nMarkerFrames) {
-            nFreq = m_nBitsInMarker;
+        m_tx.dataBits.zero();
 
-            const int fId = frameId - (m_nMarkerFrames + totalDataFrames);
-            for (int i = 0; i < m_nBitsInMarker; ++i) {
-                if (i%2 == 0) {
-                    addAmplitudeSmooth(m_tx.bit0Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, fId, m_nMarkerFrames);
+        for (int j = 0; j < m_tx.protocol.bytesPerTx; ++j) {
+            if (m_tx.protocol.extra == 1) {
+                {
+                    uint8_t d = m_tx.dataEncoded[dataOffset + j] & 15;
+                    m_tx.dataBits[(2*j + 0)*16 + d] = 1;
+                }
+                {
+                    uint8_t d = m_tx.dataEncoded[dataOffset + j] & 240;
+                    m_tx.dataBits[(2*j + 1)*16 + (d >> 4)] = 1;
+                }
+            } else {
+                if (dataOffset % m_tx.protocol.extra == 0) {
+                    uint8_t d = m_tx.dataEncoded[dataOffset/m_tx.protocol.extra + j] & 15;
+                    m_tx.dataBits[(2*j + 0)*16 + d] = 1;
                 } else {
-                    addAmplitudeSmooth(m_tx.bit1Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, fId, m_nMarkerFrames);
+                    uint8_t d = m_tx.dataEncoded[dataOffset/m_tx.protocol.extra + j] & 240;
+                    m_tx.dataBits[(2*j + 0)*16 + (d >> 4)] = 1;
                 }
             }
-        } else {
-            m_tx.hasData = false;
-            break;
         }
 
-        if (nFreq == 0) nFreq = 1;
-        const float scale = 1.0f/nFreq;
-        for (int i = 0; i < m_samplesPerFrame; ++i) {
-            m_tx.output[i] *= scale;
-        }
+        const float * envelope = m_txSymbolCache ? nullptr : txEnvelope(cycleModMain, m_tx.protocol.framesPerTx);
+        for (int k = 0; k < 2*m_tx.protocol.bytesPerTx*16; ++k) {
+            if (m_tx.dataBits[k] == 0) continue;
 
-        int samplesPerFrameOut = m_samplesPerFrame;
-        if (m_needResampling) {
-            samplesPerFrameOut = m_resampler.resample(factor, m_samplesPerFrame, m_tx.output.data(), m_tx.outputResampled.data());
-        } else {
-            m_tx.outputResampled.copy(m_tx.output);
+            ++nFreq;
+            if (m_txSymbolCache) {
+                kernels.add(m_tx.output.data(), symbols.tones[symbols.envelopeClass[cycleModMain]*symbols.nTones + k].data(), m_samplesPerFrame);
+            } else {
+                kernels.accumulate(m_tx.output.data(), txTone(k).data(), m_tx.sendVolume, envelope, m_samplesPerFrame);
+            }
         }
+    } else if (frameId < m_nMarkerFrames + totalDataFrames + m_nMarkerFrames) {
+        nFreq = m_nBitsInMarker;
 
-        // default output is in 16-bit signed int so we always compute it
-        for (int i = 0; i < samplesPerFrameOut; ++i) {
-            m_tx.outputI16[offset + i] = 32768*m_tx.outputResampled[i];
+        const int fId = frameId - (m_nMarkerFrames + totalDataFrames);
+        const float * envelope = txEnvelope(fId, m_nMarkerFrames);
+        for (int i = 0; i < m_nBitsInMarker; ++i) {
+            kernels.accumulate(m_tx.output.data(), txTone(2*i + (1 - i%2)).data(), m_tx.sendVolume, envelope, m_samplesPerFrame);
         }
+    } else {
+        m_tx.hasData  = false;
+        m_tx.encoding = false;
+        return 0;
+    }
 
-        // convert from 32-bit float
-        switch (m_sampleFormatOut) {
-            case GGWAVE_SAMPLE_FORMAT_UNDEFINED: break;
-            case GGWAVE_SAMPLE_FORMAT_U8:
-                {
-                    auto p = reinterpret_cast<uint8_t *>(m_tx.outputTmp.data());
-                    for (int i = 0; i < samplesPerFrameOut; ++i) {
-                        p[offset + i] = 128*(m_tx.outputResampled[i] + 1.0f);
-                    }
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_I8:
-                {
-                    auto p = reinterpret_cast<uint8_t *>(m_tx.outputTmp.data());
-                    for (int i = 0; i < samplesPerFrameOut; ++i) {
-                        p[offset + i] = 128*m_tx.outputResampled[i];
-                    }
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_U16:
-                {
-                    auto p = reinterpret_cast<uint16_t *>(m_tx.outputTmp.data());
-                    for (int i = 0; i < samplesPerFrameOut; ++i) {
-                        p[offset + i] = 32768*(m_tx.outputResampled[i] + 1.0f);
-                    }
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_I16:
-                {
-                    // skip because we already have the data in m_tx.outputI16
-                    //auto p = reinterpret_cast<uint16_t *>(m_tx.outputTmp.data());
-                    //for (int i = 0; i < samplesPerFrameOut; ++i) {
-                    //    p[offset + i] = 32768*m_tx.outputResampled[i];
-                    //}
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_F32:
-                {
-                    auto p = reinterpret_cast<float *>(m_tx.outputTmp.data());
-                    for (int i = 0; i < samplesPerFrameOut; ++i) {
-                        p[offset + i] = m_tx.outputResampled[i];
-                    }
-                } break;
-        }
+    if (nFreq > 0) {
+        kernels.scale(m_tx.output.data(), 1.0f/nFreq, m_samplesPerFrame);
+    }
 
-        ++frameId;
-        offset += samplesPerFrameOut;
+    int samplesPerFrameOut = m_samplesPerFrame;
+    if (m_needResamplingOut) {
+        samplesPerFrameOut = m_tx.resampler.resample(factor, m_samplesPerFrame, m_tx.output.data(), m_tx.outputResampled.data());
+    } else {
+        m_tx.outputResampled.copy(m_tx.output);
     }
 
-    m_tx.lastAmplitudeSize = offset;
+    ++m_tx.frameId;
 
-    // the encoded waveform can be accessed via the txWaveform() method
-    // we return the size of the waveform in bytes:
-    return offset*m_sampleSizeOut;
+    if (m_tx.frameId >= m_nMarkerFrames + totalDataFrames + m_nMarkerFrames) {
+        m_tx.hasData  = false;
+        m_tx.encoding = false;
+    }
+
+    return samplesPerFrameOut;
+}
+
+void GGWave::encodeConvert(const float * src, void * dst, int n, SampleFormat format) const {
+    const auto & kernels = simd::kernels();
+
+    // convert from 32-bit float
+    switch (format) {
+        case GGWAVE_SAMPLE_FORMAT_UNDEFINED: break;
+        case GGWAVE_SAMPLE_FORMAT_U8:  kernels.convertU8 (src, reinterpret_cast<uint8_t  *>(dst), n); break;
+        case GGWAVE_SAMPLE_FORMAT_I8:  kernels.convertI8 (src, reinterpret_cast<int8_t   *>(dst), n); break;
+        case GGWAVE_SAMPLE_FORMAT_U16: kernels.convertU16(src, reinterpret_cast<uint16_t *>(dst), n); break;
+        case GGWAVE_SAMPLE_FORMAT_I16: kernels.convertI16(src, reinterpret_cast<int16_t  *>(dst), n); break;
+        case GGWAVE_SAMPLE_FORMAT_F32: memcpy(dst, src, n*sizeof(float)); break;
+    }
 }
 
 bool GGWave::decode(const void * data, uint32_t nBytes) {
@@ -1060,21 +1432,29 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
         return false;
     }
 
-    if (m_tx.hasData) {
-        ggprintf("Cannot decode while transmitting\n");
-        return false;
-    }
-
     auto dataBuffer = (uint8_t *) data;
     const float factor = m_sampleRateInp/m_sampleRate;
 
+    // note : without a budget, budgetLeft is not touched - the asynchronous analysis runs on the executor
+    if (m_rxAnalysisBudget > 0) {
+        m_rx.analysis.budgetLeft = m_rxAnalysisBudget;
+    }
+
+    // continue the analysis from the previous calls, even if there is not enough new data for a frame
+    if (m_rx.analyzing && m_isFixedPayloadLength == false) {
+        analyze();
+    }
+
+    if (m_rx.captureReady) {
+        handOffCapture();
+    }
+
     while (true) {
         // read capture data
         uint32_t nBytesNeeded = m_rx.samplesNeeded*m_sampleSizeInp;
 
-        if (m_needResampling) {
-            // note : predict 4 extra samples just to make sure we have enough data
-            nBytesNeeded = (m_resampler.resample(1.0f/factor, m_rx.samplesNeeded, m_rx.amplitudeResampled.data(), nullptr) + 4)*m_sampleSizeInp;
+        if (m_needResamplingInp) {
+            nBytesNeeded = m_rx.resampler.nSamplesInpNeeded(factor, m_rx.samplesNeeded)*m_sampleSizeInp;
         }
 
         const uint32_t nBytesRecorded = GG_MIN(nBytes, nBytesNeeded);
@@ -1083,6 +1463,11 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
             break;
         }
 
+        const uint32_t offset = m_samplesPerFrame - m_rx.samplesNeeded;
+
+        // without resampling, the samples are converted directly into the current frame
+        float * dst = m_needResamplingInp ? m_rx.amplitudeResampled.data() : m_rx.amplitude.data() + offset;
+
         switch (m_sampleFormatInp) {
             case GGWAVE_SAMPLE_FORMAT_UNDEFINED: break;
             case GGWAVE_SAMPLE_FORMAT_U8:
@@ -1094,7 +1479,7 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
                 } break;
             case GGWAVE_SAMPLE_FORMAT_F32:
                 {
-                    memcpy(m_rx.amplitudeResampled.data(), dataBuffer, nBytesRecorded);
+                    memcpy(dst, dataBuffer, nBytesRecorded);
                 } break;
         }
 
@@ -1117,7 +1502,7 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
                     constexpr float scale = 1.0f/128;
                     auto p = reinterpret_cast<uint8_t *>(m_rx.amplitudeTmp.data());
                     for (int i = 0; i < nSamplesRecorded; ++i) {
-                        m_rx.amplitudeResampled[i] = float(int16_t(*(p + i)) - 128)*scale;
+                        dst[i] = float(int16_t(*(p + i)) - 128)*scale;
                     }
                 } break;
             case GGWAVE_SAMPLE_FORMAT_I8:
@@ -1125,7 +1510,7 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
                     constexpr float scale = 1.0f/128;
                     auto p = reinterpret_cast<int8_t *>(m_rx.amplitudeTmp.data());
                     for (int i = 0; i < nSamplesRecorded; ++i) {
-                        m_rx.amplitudeResampled[i] = float(*(p + i))*scale;
+                        dst[i] = float(*(p + i))*scale;
                     }
                 } break;
             case GGWAVE_SAMPLE_FORMAT_U16:
@@ -1133,7 +1518,7 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
                     constexpr float scale = 1.0f/32768;
                     auto p = reinterpret_cast<uint16_t *>(m_rx.amplitudeTmp.data());
                     for (int i = 0; i < nSamplesRecorded; ++i) {
-                        m_rx.amplitudeResampled[i] = float(int32_t(*(p + i)) - 32768)*scale;
+                        dst[i] = float(int32_t(*(p + i)) - 32768)*scale;
                     }
                 } break;
             case GGWAVE_SAMPLE_FORMAT_I16:
@@ -1141,33 +1526,24 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
                     constexpr float scale = 1.0f/32768;
                     auto p = reinterpret_cast<int16_t *>(m_rx.amplitudeTmp.data());
                     for (int i = 0; i < nSamplesRecorded; ++i) {
-                        m_rx.amplitudeResampled[i] = float(*(p + i))*scale;
+                        dst[i] = float(*(p + i))*scale;
                     }
                 } break;
             case GGWAVE_SAMPLE_FORMAT_F32: break;
         }
 
-        uint32_t offset = m_samplesPerFrame - m_rx.samplesNeeded;
-
-        if (m_needResampling) {
-            if (nSamplesRecorded <= 2*Resampler::kWidth) {
+        if (m_needResamplingInp) {
+            // the sinc resampler needs more than kWidth new samples per call, the polyphase one keeps its own history
+            if (m_rx.resampler.type() == GGWAVE_RESAMPLER_SINC && nSamplesRecorded <= 2*Resampler::kWidth) {
                 m_rx.samplesNeeded = m_samplesPerFrame;
                 break;
             }
 
-            // reset resampler state every minute
-            if (!m_rx.receiving && m_resampler.nSamplesTotal() > 60.0f*factor*m_sampleRate) {
-                m_resampler.reset();
-            }
-
-            int nSamplesResampled = offset + m_resampler.resample(factor, nSamplesRecorded, m_rx.amplitudeResampled.data(), m_rx.amplitude.data() + offset);
-            nSamplesRecorded = nSamplesResampled;
-        } else {
-            for (int i = 0; i < nSamplesRecorded; ++i) {
-                m_rx.amplitude[offset + i] = m_rx.amplitudeResampled[i];
-            }
+            nSamplesRecorded = m_rx.resampler.resample(factor, nSamplesRecorded, m_rx.amplitudeResampled.data(), m_rx.amplitude.data() + offset);
         }
 
+        nSamplesRecorded += offset;
+
         // we have enough bytes to do analysis
         if (nSamplesRecorded >= m_samplesPerFrame) {
             m_rx.hasNewAmplitude = true;
@@ -1178,11 +1554,20 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
                 decode_variable();
             }
 
-            int nExtraSamples = nSamplesRecorded - m_samplesPerFrame;
-            for (int i = 0; i < nExtraSamples; ++i) {
-                m_rx.amplitude[i] = m_rx.amplitude[m_samplesPerFrame + i];
+            // while recording, the next frame is written directly into its slot in the recording
+            float * next = m_rx.amplitudeBuffer.data();
+            if (m_rx.framesLeftToRecord > 0 && m_rxRecordI16 == false) {
+                next = m_rx.amplitudeRecorded.data() + (m_rx.framesToRecord - m_rx.framesLeftToRecord)*m_samplesPerFrame;
+            }
+
+            // the extra resampled samples are already in place if the next slot follows the current one
+            const int nExtraSamples = nSamplesRecorded - m_samplesPerFrame;
+            if (nExtraSamples > 0 && next != m_rx.amplitude.data() + m_samplesPerFrame) {
+                memmove(next, m_rx.amplitude.data() + m_samplesPerFrame, nExtraSamples*sizeof(float));
             }
 
+            m_rx.amplitude.assign(Amplitude(next, m_rx.amplitudeBuffer.size()));
+
             m_rx.samplesNeeded = m_samplesPerFrame - nExtraSamples;
         } else {
             m_rx.samplesNeeded = m_samplesPerFrame - nSamplesRecorded;
@@ -1249,6 +1634,44 @@ bool GGWave::txTakeAmplitudeI16(AmplitudeI16 & dst) {
 
 const GGWave::RxProtocols & GGWave::txProtocols() const { return m_tx.protocols; }
 
+bool GGWave::txShareToneTables(GGWave & other) {
+    if (this == &other) {
+        m_tx.toneTablesShared = nullptr;
+        return true;
+    }
+
+    if (m_isTxEnabled == false || m_txOnlyTones || other.m_isTxEnabled == false || other.m_txOnlyTones) {
+        ggprintf("Tone tables can be shared only between instances that synthesize Tx audio\n");
+        return false;
+    }
+
+    if (other.m_tx.toneTablesShared) {
+        ggprintf("Cannot share tone tables that are borrowed from another instance\n");
+        return false;
+    }
+
+    if (m_sampleRate != other.m_sampleRate || m_samplesPerFrame != other.m_samplesPerFrame) {
+        ggprintf("Cannot share tone tables - sample rate or samples per frame do not match: %g Hz / %d vs %g Hz / %d\n",
+                 m_sampleRate, m_samplesPerFrame, other.m_sampleRate, other.m_samplesPerFrame);
+        return false;
+    }
+
+    if (m_txNCO != other.m_txNCO) {
+        ggprintf("Cannot share tone tables - the tone synthesis methods do not match\n");
+        return false;
+    }
+
+    if (other.m_tx.toneTables.phaseOffsets.size() < m_tx.toneTables.phaseOffsets.size()) {
+        ggprintf("Cannot share tone tables - not enough capacity: %d < %d\n",
+                 other.m_tx.toneTables.phaseOffsets.size(), m_tx.toneTables.phaseOffsets.size());
+        return false;
+    }
+
+    m_tx.toneTablesShared = &other.m_tx.toneTables;
+
+    return true;
+}
+
 //
 // Rx
 //
@@ -1263,12 +1686,52 @@ int GGWave::rxFramesToAnalyze()     const { return m_rx.framesToAnalyze; }
 int GGWave::rxFramesLeftToAnalyze() const { return m_rx.framesLeftToAnalyze; }
 int GGWave::rxDurationFrames()      const { return m_rx.recvDuration_frames; }
 
+const GGWave::RxAnalysisStats & GGWave::rxAnalysisStats() const { return m_rx.analysisStats; }
+const GGWave::RxListenStats &   GGWave::rxListenStats()   const { return m_rx.listenStats; }
+
+void GGWave::rxSetAnalysisExecutor(RxAnalysisExecutor executor, void * userData) {
+    m_rxExecutor = executor;
+    m_rxExecutorUserData = userData;
+}
+
+void GGWave::rxSetCallback(RxCallback callback, void * userData) {
+    m_rxCallback = callback;
+    m_rxCallbackUserData = userData;
+}
+
+bool GGWave::rxAnalyzeCapture() {
+    if (::ggAtomicLoad(&m_rx.analysisInFlight) == 0) {
+        return false;
+    }
+
+    analyze();
+
+    return true;
+}
+
+bool GGWave::rxAnalysisInFlight() const { return ::ggAtomicLoad(&m_rx.analysisInFlight); }
+
+void GGWave::rxSetParallelExecutor(RxParallelExecutor executor, void * userData) {
+    m_rxParallelExecutor = executor;
+    m_rxParallelExecutorUserData = userData;
+}
+
 bool GGWave::rxStopReceiving() {
     if (m_rx.receiving == false) {
         return false;
     }
 
     m_rx.receiving = false;
+    m_rx.captureReady = false;
+
+    // an analysis on the executor is not interrupted
+    if (m_rxAsyncAnalysis == false) {
+        m_rx.analyzing = false;
+        m_rx.analysis.started = false;
+
+        m_rx.framesToAnalyze = 0;
+        m_rx.framesLeftToAnalyze = 0;
+    }
 
     return true;
 }
@@ -1320,16 +1783,48 @@ bool GGWave::computeFFTR(const float * src, float * dst, int N) {
         return false;
     }
 
-    FFT(src, dst, N, m_rx.fftWorkI.data(), m_rx.fftWorkF.data());
+    if (m_fft == nullptr) {
+        ggprintf("computeFFTR: Rx is not enabled\n");
+        return false;
+    }
+
+    FFT(src, dst, N, m_fft);
 
     return true;
 }
 
 int GGWave::computeFFTR(const float * src, float * dst, int N, int * wi, float * wf) {
     if (wi == nullptr) return 2*N;
-    if (wf == nullptr) return 3 + sqrt(N/2);
+    if (wf == nullptr) return 3 + N/2;
+
+    // the sizes without a shared plan use the Ooura FFT with the tables in the work buffers
+    if (fft::plan(N) == nullptr) {
+        memcpy(dst, src, N*sizeof(float));
+        rdft(N, 1, dst, wi, wf);
+
+        return 1;
+    }
+
+    FFT(src, dst, N, fftBackend().transform(N));
+
+    return 1;
+}
 
-    FFT(src, dst, N, wi, wf);
+int GGWave::computeFFTRBatch(const float * src, float * dst, int N, int count, float * w) {
+    if (w == nullptr) return fft::batchWorkSize(N);
+
+    if (fft::plan(N) == nullptr) {
+        ggprintf("computeFFTRBatch: N (%d) must be a power of 2, max: %d, or the FFT tables could not be allocated\n", N, kMaxSamplesPerFrame);
+        return 0;
+    }
+
+    if (count < 0) {
+        ggprintf("computeFFTRBatch: invalid number of frames: %d\n", count);
+        return 0;
+    }
+
+    const auto & backend = fftBackend();
+    FFTBatch(src, dst, N, count, backend.transform(N), backend.transformBatch ? backend.transformBatch(N) : nullptr, w);
 
     return 1;
 }
@@ -1409,25 +1904,83 @@ int GGWave::filter(ggwave_Filter filter, float * waveform, int N, float p0, floa
 
 GGWave::Resampler::Resampler() {}
 
+void GGWave::Resampler::configure(ResamplerType type, int quality) {
+    m_type  = type;
+    m_width = type == GGWAVE_RESAMPLER_POLYPHASE ? 16*quality : kWidth;
+}
+
 bool GGWave::Resampler::alloc(void * p, int & n) {
-    ggalloc(m_sincTable,   kWidth*kSamplesPerZeroCrossing, p, n);
-    ggalloc(m_delayBuffer, 3*kWidth, p, n);
-    ggalloc(m_edgeSamples, kWidth, p, n);
-    ggalloc(m_samplesInp,  4096, p, n);
+    if (m_type == GGWAVE_RESAMPLER_POLYPHASE) {
+        ggalloc(m_phases,  (kPhases + 1)*2*m_width, p, n);
+        ggalloc(m_history, 2*kHistorySize, p, n);
+    } else {
+        ggalloc(m_sincTable,   kWidth*kSamplesPerZeroCrossing, p, n);
+        ggalloc(m_delayBuffer, 3*kWidth, p, n);
+        ggalloc(m_edgeSamples, kWidth, p, n);
+        ggalloc(m_samplesInp,  4096, p, n);
+    }
 
     if (p) {
-        makeSinc();
+        if (m_type == GGWAVE_RESAMPLER_SINC) {
+            makeSinc();
+        }
+        m_phasesFactor = 0.0f;
         reset();
     }
 
     return true;
 }
 
+// only the buffers of the configured type are allocated
 void GGWave::Resampler::reset() {
     m_state = {};
-    m_edgeSamples.zero();
-    m_delayBuffer.zero();
-    m_samplesInp.zero();
+    if (m_type == GGWAVE_RESAMPLER_POLYPHASE) {
+        m_history.zero();
+    } else {
+        m_edgeSamples.zero();
+        m_delayBuffer.zero();
+        m_samplesInp.zero();
+    }
+}
+
+int GGWave::Resampler::nSamplesOutTotal(float factor, int nSamplesInp) {
+    if (nSamplesInp <= 0) {
+        return 0;
+    }
+
+    // output sample k is produced once floor(k*factor) input samples have been consumed
+    int p = 0;
+    int q = 0;
+    if (getRatio(factor, p, q)) {
+        return (int) (((int64_t) (nSamplesInp + 1)*q + p - 1)/p);
+    }
+
+    const double f = factor;
+    const double t = nSamplesInp + 1;
+
+    int k = t/f;
+    while (k > 0 && k*f >= t) --k;
+    while ((k + 1)*f < t) ++k;
+
+    return k + 1;
+}
+
+int GGWave::Resampler::nSamplesInpNeeded(float factor, int nSamplesOut) const {
+    // a different factor restarts the resampler
+    const bool isReset = m_state.factor != factor;
+
+    const int64_t nInp = isReset ? 0 : m_state.nSamplesTotal;
+    const int64_t nOut = isReset ? 0 : m_state.nSamplesOut;
+
+    const int64_t k = nOut + nSamplesOut - 1;
+
+    int p = 0;
+    int q = 0;
+    if (getRatio(factor, p, q)) {
+        return (int) GG_MAX(1, (k*p)/q - nInp);
+    }
+
+    return (int) GG_MAX(1, (int64_t) (k*(double) factor) - nInp);
 }
 
 int GGWave::Resampler::resample(
@@ -1435,87 +1988,73 @@ int GGWave::Resampler::resample(
         int nSamples,
         const float * samplesInp,
         float * samplesOut) {
-    int idxInp = -1;
-    int idxOut = 0;
-    int notDone = 1;
-    float data_in = 0.0f;
-    float data_out = 0.0f;
-    double one_over_factor = 1.0;
-
     auto stateSave = m_state;
 
+    if (m_state.factor != factor) {
+        // the output sample times are computed relative to the last reset
+        if (samplesOut) {
+            reset();
+        } else {
+            m_state = {};
+        }
+        m_state.factor = factor;
+        getRatio(factor, m_state.p, m_state.q);
+    }
+
     m_state.nSamplesTotal += nSamples;
 
     if (samplesOut) {
-        assert(nSamples > kWidth);
-        assert((int) m_samplesInp.size() >= nSamples + kWidth);
-        //if ((int) m_samplesInp.size() < nSamples + kWidth) {
-        //    m_samplesInp.resize(nSamples + kWidth);
-        //}
-        for (int i = 0; i < kWidth; ++i) {
-            m_samplesInp[i] = m_edgeSamples[i];
-            m_edgeSamples[i] = samplesInp[nSamples - kWidth + i];
-        }
-        for (int i = 0; i < nSamples; ++i) {
-            m_samplesInp[i + kWidth] = samplesInp[i];
+        if (m_type == GGWAVE_RESAMPLER_POLYPHASE) {
+            if (m_phasesFactor != factor) {
+                makePolyphase(factor);
+            }
+        } else {
+            assert(nSamples > kWidth);
+            assert((int) m_samplesInp.size() >= nSamples + kWidth);
+            for (int i = 0; i < kWidth; ++i) {
+                m_samplesInp[i] = m_edgeSamples[i];
+                m_edgeSamples[i] = samplesInp[nSamples - kWidth + i];
+            }
+            for (int i = 0; i < nSamples; ++i) {
+                m_samplesInp[i + kWidth] = samplesInp[i];
+            }
+            samplesInp = m_samplesInp.data();
         }
-        samplesInp = m_samplesInp.data();
     }
 
-    while (notDone) {
+    int idxInp = 0;
+    int idxOut = 0;
+
+    while (true) {
+        bool isDone = false;
         while (m_state.timeLast < m_state.timeInt) {
-            if (++idxInp >= nSamples) {
-                notDone = 0;
+            if (idxInp >= nSamples) {
+                isDone = true;
                 break;
-            } else {
-                data_in = samplesInp[idxInp];
             }
-            //printf("xxxx idxInp = %d\n", idxInp);
-            if (samplesOut) newData(data_in);
-            m_state.timeLast += 1;
-        }
 
-        if (notDone == false) break;
-
-        double temp1 = 0.0;
-        int left_limit = m_state.timeNow - kWidth + 1; /* leftmost neighboring sample used for interp.*/
-        int right_limit = m_state.timeNow + kWidth;    /* rightmost leftmost neighboring sample used for interp.*/
-        if (left_limit < 0) left_limit = 0;
-        if (right_limit > m_state.nSamplesTotal + kWidth) right_limit = m_state.nSamplesTotal + kWidth;
-        if (factor < 1.0) {
-            for (int j = left_limit; j < right_limit; j++) {
-                temp1 += getData(j - m_state.timeInt)*sinc(m_state.timeNow - (double) j);
-            }
-            data_out = temp1;
-        }
-        else {
-            one_over_factor = 1.0 / factor;
-            for (int j = left_limit; j < right_limit; j++) {
-                temp1 += getData(j - m_state.timeInt)*one_over_factor*sinc(one_over_factor*(m_state.timeNow - (double) j));
+            if (samplesOut) {
+                if (m_type == GGWAVE_RESAMPLER_POLYPHASE) {
+                    const int i = m_state.timeLast & (kHistorySize - 1);
+                    m_history[i] = samplesInp[idxInp];
+                    m_history[i + kHistorySize] = samplesInp[idxInp];
+                } else {
+                    newData(samplesInp[idxInp]);
+                }
             }
-            data_out = temp1;
+
+            ++idxInp;
+            m_state.timeLast += 1;
         }
 
+        if (isDone) break;
+
         if (samplesOut) {
-            //printf("inp = %d, l = %d, r = %d, n = %d, a = %d, b = %d\n", idxInp, left_limit, right_limit, m_state.nSamplesTotal, left_limit - m_state.timeInt, right_limit - m_state.timeInt - 1);
-            samplesOut[idxOut] = data_out;
+            samplesOut[idxOut] = m_type == GGWAVE_RESAMPLER_POLYPHASE ? interpolatePolyphase() : interpolateSinc(factor);
         }
         ++idxOut;
 
-        m_state.timeNow += factor;
-        m_state.timeLast = m_state.timeInt;
-        m_state.timeInt = m_state.timeNow;
-        while (m_state.timeLast < m_state.timeInt) {
-            if (++idxInp >= nSamples) {
-                notDone = 0;
-                break;
-            } else {
-                data_in = samplesInp[idxInp];
-            }
-            if (samplesOut) newData(data_in);
-            m_state.timeLast += 1;
-        }
-        //printf("last idxInp = %d, nSamples = %d\n", idxInp, nSamples);
+        advance();
     }
 
     if (samplesOut == nullptr) {
@@ -1525,6 +2064,119 @@ int GGWave::Resampler::resample(
     return idxOut;
 }
 
+bool GGWave::Resampler::getRatio(float factor, int & p, int & q) {
+    p = 0;
+    q = 0;
+
+    // continued fraction expansion - stop at the first convergent that matches the factor
+    double x = factor;
+    int64_t p0 = 0, p1 = 1;
+    int64_t q0 = 1, q1 = 0;
+    for (int i = 0; i < 32; ++i) {
+        const double a = floor(x);
+        const int64_t p2 = (int64_t) a*p1 + p0;
+        const int64_t q2 = (int64_t) a*q1 + q0;
+        if (q2 > kPhases || p2 > (1 << 20)) {
+            break;
+        }
+
+        if ((float) ((double) p2/q2) == factor) {
+            p = (int) p2;
+            q = (int) q2;
+            return true;
+        }
+
+        p0 = p1; p1 = p2;
+        q0 = q1; q1 = q2;
+
+        if (x - a < 1e-9) {
+            break;
+        }
+        x = 1.0/(x - a);
+    }
+
+    return false;
+}
+
+void GGWave::Resampler::advance() {
+    m_state.nSamplesOut += 1;
+    m_state.timeLast = m_state.timeInt;
+
+    if (m_state.q > 0) {
+        m_state.timeNum += m_state.p;
+        m_state.timeInt += m_state.timeNum/m_state.q;
+        m_state.timeNum %= m_state.q;
+        m_state.timeNow  = m_state.timeInt + (double) m_state.timeNum/m_state.q;
+    } else {
+        // note : the product is exact, so the sample times do not accumulate rounding errors
+        m_state.timeNow = m_state.nSamplesOut*(double) m_state.factor;
+        m_state.timeInt = m_state.timeNow;
+    }
+}
+
+float GGWave::Resampler::interpolateSinc(float factor) const {
+    double temp1 = 0.0;
+    int64_t left_limit = m_state.timeNow - kWidth + 1; /* leftmost neighboring sample used for interp.*/
+    int64_t right_limit = m_state.timeNow + kWidth;    /* rightmost leftmost neighboring sample used for interp.*/
+    if (left_limit < 0) left_limit = 0;
+    if (right_limit > m_state.nSamplesTotal + kWidth) right_limit = m_state.nSamplesTotal + kWidth;
+    if (factor < 1.0) {
+        for (int64_t j = left_limit; j < right_limit; j++) {
+            temp1 += getData((int) (j - m_state.timeInt))*sinc(m_state.timeNow - (double) j);
+        }
+    } else {
+        const double one_over_factor = 1.0 / factor;
+        for (int64_t j = left_limit; j < right_limit; j++) {
+            temp1 += getData((int) (j - m_state.timeInt))*one_over_factor*sinc(one_over_factor*(m_state.timeNow - (double) j));
+        }
+    }
+
+    return temp1;
+}
+
+float GGWave::Resampler::interpolatePolyphase() const {
+    const int nTaps = 2*m_width;
+
+    // oldest input sample in the filter window
+    const float * x = m_history.data() + ((m_state.timeInt - m_width + 1 - kLatency) & (kHistorySize - 1));
+
+    if (m_state.q > 0) {
+        const float * c = m_phases.data() + m_state.timeNum*nTaps;
+
+        float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < nTaps; i += 4) {
+            sum[0] += x[i + 0]*c[i + 0];
+            sum[1] += x[i + 1]*c[i + 1];
+            sum[2] += x[i + 2]*c[i + 2];
+            sum[3] += x[i + 3]*c[i + 3];
+        }
+
+        return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    }
+
+    // linear interpolation between the two nearest phases
+    const double pos = (m_state.timeNow - m_state.timeInt)*kPhases;
+    const int    r   = pos;
+    const float  a   = pos - r;
+
+    const float * c0 = m_phases.data() + r*nTaps;
+    const float * c1 = c0 + nTaps;
+
+    float sum0[2] = { 0.0f, 0.0f };
+    float sum1[2] = { 0.0f, 0.0f };
+    for (int i = 0; i < nTaps; i += 2) {
+        sum0[0] += x[i + 0]*c0[i + 0];
+        sum0[1] += x[i + 1]*c0[i + 1];
+        sum1[0] += x[i + 0]*c1[i + 0];
+        sum1[1] += x[i + 1]*c1[i + 1];
+    }
+
+    const float s0 = sum0[0] + sum0[1];
+    const float s1 = sum1[0] + sum1[1];
+
+    return s0 + a*(s1 - s0);
+}
+
 float GGWave::Resampler::getData(int j) const {
     return m_delayBuffer[(int) j + kWidth];
 }
@@ -1548,6 +2200,28 @@ void GGWave::Resampler::makeSinc() {
     }
 }
 
+void GGWave::Resampler::makePolyphase(float factor) {
+    const int nTaps = 2*m_width;
+    const int nPhases = m_state.q > 0 ? m_state.q : kPhases + 1;
+
+    // when downsampling, the cutoff is at the output Nyquist frequency
+    const double scale = factor > 1.0f ? 1.0/factor : 1.0;
+
+    for (int r = 0; r < nPhases; ++r) {
+        const double phase = m_state.q > 0 ? (double) r/m_state.q : (double) r/kPhases;
+        for (int i = 0; i < nTaps; ++i) {
+            const double x = phase - (i - m_width + 1);
+            const double u = M_PI*x*scale;
+            const double s = u == 0.0 ? 1.0 : sin(u)/u;
+            const double w = 0.5 + 0.5*cos(M_PI*x/m_width);
+
+            m_phases[r*nTaps + i] = scale*s*w;
+        }
+    }
+
+    m_phasesFactor = factor;
+}
+
 double GGWave::Resampler::sinc(double x) const {
     int low;
     double temp, delta;
@@ -1566,309 +2240,870 @@ double GGWave::Resampler::sinc(double x) const {
 //
 
 void GGWave::decode_variable() {
+    // keep the sum of the history up to date only if the spectrum is needed before the next full summation
+    if (m_rx.amplitudeSumValid && (m_rx.receiving || m_rxMarkerHop < kMaxSpectrumHistory)) {
+        const auto s = m_rx.amplitudeHistory[m_rx.historyId];
+        for (int i = 0; i < m_samplesPerFrame; ++i) {
+            m_rx.amplitudeSum[i] += m_rx.amplitude[i] - s[i];
+        }
+    } else {
+        m_rx.amplitudeSumValid = false;
+    }
+
     m_rx.amplitudeHistory[m_rx.historyId].copy(m_rx.amplitude);
 
     if (++m_rx.historyId >= kMaxSpectrumHistory) {
         m_rx.historyId = 0;
     }
 
-    if (m_rx.historyId == 0 || m_rx.receiving) {
-        m_rx.hasNewSpectrum = true;
+    // while waiting for a start marker, the spectrum is updated only once every m_rxMarkerHop frames
+    bool isNewSpectrum = m_rx.historyId % m_rxMarkerHop == 0 || m_rx.receiving;
 
-        m_rx.amplitudeAverage.zero();
-        for (int j = 0; j < (int) m_rx.amplitudeHistory.size(); ++j) {
-            auto s = m_rx.amplitudeHistory[j];
-            for (int i = 0; i < m_samplesPerFrame; ++i) {
-                m_rx.amplitudeAverage[i] += s[i];
+    const bool isListening = m_rx.receiving == false && m_rx.analyzing == false && m_rx.captureReady == false;
+
+    if (isListening) {
+        ++m_rx.listenStats.nFrames;
+    }
+
+    if (isNewSpectrum) {
+        // the running sum accumulates rounding errors, so it is recomputed once per history cycle
+        if (m_rx.historyId == 0 || m_rx.amplitudeSumValid == false) {
+            m_rx.amplitudeSum.zero();
+            for (int j = 0; j < (int) m_rx.amplitudeHistory.size(); ++j) {
+                auto s = m_rx.amplitudeHistory[j];
+                for (int i = 0; i < m_samplesPerFrame; ++i) {
+                    m_rx.amplitudeSum[i] += s[i];
+                }
             }
+
+            m_rx.amplitudeSumValid = true;
         }
 
         float norm = 1.0f/kMaxSpectrumHistory;
         for (int i = 0; i < m_samplesPerFrame; ++i) {
-            m_rx.amplitudeAverage[i] *= norm;
+            m_rx.amplitudeAverage[i] = m_rx.amplitudeSum[i]*norm;
         }
 
-        // calculate spectrum
-        FFT(m_rx.amplitudeAverage.data(), m_rx.fftOut.data(), m_samplesPerFrame, m_rx.fftWorkI.data(), m_rx.fftWorkF.data());
-
-        for (int i = 0; i < m_samplesPerFrame; ++i) {
-            m_rx.spectrum[i] = (m_rx.fftOut[2*i + 0]*m_rx.fftOut[2*i + 0] + m_rx.fftOut[2*i + 1]*m_rx.fftOut[2*i + 1]);
+        if (isListening && m_rxEnergyGate && energyGateOpen() == false) {
+            ++m_rx.listenStats.nSpectraGated;
+            isNewSpectrum = false;
         }
-        for (int i = 1; i < m_samplesPerFrame/2; ++i) {
-            m_rx.spectrum[i] += m_rx.spectrum[m_samplesPerFrame - i];
+    }
+
+    if (isNewSpectrum) {
+        if (isListening) {
+            ++m_rx.listenStats.nSpectra;
         }
+
+        m_rx.hasNewSpectrum = true;
+
+        // calculate spectrum
+        int bin0, bin1;
+        spectrumBand(bin0, bin1);
+        FFTBand(m_rx.amplitudeAverage.data(), m_rx.fftOut.data(), m_samplesPerFrame, bin0, bin1, m_fft, m_fftBand, m_rx.fftWork.data());
+        powerSpectrum(m_rx.fftOut.data(), m_rx.spectrum.data(), m_samplesPerFrame, bin0, bin1);
     }
 
     if (m_rx.framesLeftToRecord > 0) {
-        memcpy(m_rx.amplitudeRecorded.data() + (m_rx.framesToRecord - m_rx.framesLeftToRecord)*m_samplesPerFrame,
-               m_rx.amplitude.data(),
-               m_samplesPerFrame*sizeof(float));
+        const int offset = (m_rx.framesToRecord - m_rx.framesLeftToRecord)*m_samplesPerFrame;
+
+        if (m_rxRecordI16) {
+            int16_t * dst = m_rx.amplitudeRecordedI16.data() + offset;
+            for (int i = 0; i < m_samplesPerFrame; ++i) {
+                const float v = m_rx.amplitude[i]*32768.0f;
+                dst[i] = v >= 32767.0f ? 32767 : (v <= -32768.0f ? -32768 : (int16_t) lrintf(v));
+            }
+        } else {
+            // the frame is usually already in place - see decode()
+            if (m_rx.amplitude.data() != m_rx.amplitudeRecorded.data() + offset) {
+                memcpy(m_rx.amplitudeRecorded.data() + offset, m_rx.amplitude.data(), m_samplesPerFrame*sizeof(float));
+            }
+        }
 
         if (--m_rx.framesLeftToRecord <= 0) {
-            m_rx.analyzing = true;
+            if (m_rxAsyncAnalysis) {
+                m_rx.captureReady = true;
+            } else {
+                m_rx.analysis.markerFreqStart     = m_rx.markerFreqStart;
+                m_rx.analysis.recvDuration_frames = m_rx.recvDuration_frames;
+
+                m_rx.analyzing = true;
+            }
+        }
+    }
+
+    if (m_rx.captureReady) {
+        if (handOffCapture() == false) {
+            // the previous capture is still being analyzed - keep this one and do not look for markers until it is handed off
+            return;
         }
     }
 
     if (m_rx.analyzing) {
-        ggprintf("Analyzing captured data ..\n");
+        if (analyze() == false) {
+            // the recorded data is not analyzed yet - do not look for markers until it is
+            return;
+        }
+    }
 
-        const int stepsPerFrame = 16;
-        const int step = m_samplesPerFrame/stepsPerFrame;
+    // check if receiving data
+    if (m_rx.receiving == false) {
+        if (isNewSpectrum == false) {
+            // the spectrum has not changed since the last check
+            return;
+        }
 
-        bool isValid = false;
-        for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
-            const auto & protocol = m_rx.protocols[protocolId];
+        bool isReceiving = false;
+
+        for (int i = 0; i < m_rx.protocols.size(); ++i) {
+            const auto & protocol = m_rx.protocols[i];
             if (protocol.enabled == false) {
                 continue;
             }
 
-            // skip Rx protocol if it is mono-tone
-            if (protocol.extra == 2) {
-                continue;
-            }
+            const int * bins = markerBins(i);
 
-            // skip Rx protocol if start frequency is different from detected one
-            if (protocol.freqStart != m_rx.markerFreqStart) {
-                continue;
-            }
+            int nDetectedMarkerBits = m_nBitsInMarker;
 
-            m_rx.spectrum.zero();
+            for (int i = 0; i < m_nBitsInMarker; ++i) {
+                const int bin = bins[i];
 
-            m_rx.framesToAnalyze = m_nMarkerFrames*stepsPerFrame;
-            m_rx.framesLeftToAnalyze = m_rx.framesToAnalyze;
+                if (i%2 == 0) {
+                    if (m_rx.spectrum[bin] <= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) --nDetectedMarkerBits;
+                } else {
+                    if (m_rx.spectrum[bin] >= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) --nDetectedMarkerBits;
+                }
+            }
 
-            // note : not sure if looping backwards here is more meaningful than looping forwards
-            for (int ii = m_nMarkerFrames*stepsPerFrame - 1; ii >= 0; --ii) {
-                bool knownLength = false;
+            if (nDetectedMarkerBits == m_nBitsInMarker) {
+                m_rx.markerFreqStart = protocol.freqStart;
+                isReceiving = true;
+                break;
+            }
+        }
 
-                int decodedLength = 0;
-                const int offsetStart = ii;
-                for (int itx = 0; itx < 1024; ++itx) {
-                    int offsetTx = offsetStart + itx*protocol.framesPerTx*stepsPerFrame;
-                    if (offsetTx >= m_rx.recvDuration_frames*stepsPerFrame || (itx + 1)*protocol.bytesPerTx >= (int) m_dataEncoded.size()) {
-                        break;
-                    }
+        if (isReceiving) {
+            if (++m_rx.nMarkersSuccess >= 1) {
+            } else {
+                isReceiving = false;
+            }
+        } else {
+            m_rx.nMarkersSuccess = 0;
+        }
 
-                    memcpy(m_rx.fftOut.data(),
-                           m_rx.amplitudeRecorded.data() + offsetTx*step,
-                           m_samplesPerFrame*sizeof(float));
+        if (isReceiving) {
+            ggprintf("Receiving sound data ...\n");
 
-                    // note : should we skip the first and last frame here as they are amplitude-smoothed?
-                    for (int k = 1; k < protocol.framesPerTx; ++k) {
-                        for (int i = 0; i < m_samplesPerFrame; ++i) {
-                            m_rx.fftOut[i] += m_rx.amplitudeRecorded[(offsetTx + k*stepsPerFrame)*step + i];
-                        }
-                    }
+            m_rx.receiving = true;
+            m_rx.data.zero();
 
-                    FFT(m_rx.fftOut.data(), m_samplesPerFrame, m_rx.fftWorkI.data(), m_rx.fftWorkF.data());
+            // max recieve duration
+            // note : the recording fits the Rx protocols at prepare() - protocols enabled later may be cut short
+            m_rx.recvDuration_frames = GG_MIN(maxRecvDurationFrames(m_rx.protocols), m_rx.recordedFrames);
 
-                    for (int i = 0; i < m_samplesPerFrame; ++i) {
-                        m_rx.spectrum[i] = (m_rx.fftOut[2*i + 0]*m_rx.fftOut[2*i + 0] + m_rx.fftOut[2*i + 1]*m_rx.fftOut[2*i + 1]);
-                    }
-                    for (int i = 1; i < m_samplesPerFrame/2; ++i) {
-                        m_rx.spectrum[i] += m_rx.spectrum[m_samplesPerFrame - i];
-                    }
+            m_rx.nMarkersSuccess = 0;
+            m_rx.framesToRecord = m_rx.recvDuration_frames;
+            m_rx.framesLeftToRecord = m_rx.recvDuration_frames;
+        }
+    } else {
+        bool isEnded = false;
 
-                    uint8_t curByte = 0;
-                    for (int i = 0; i < 2*protocol.bytesPerTx; ++i) {
-                        double freq = m_hzPerSample*protocol.freqStart;
-                        int bin = round(freq*m_ihzPerSample) + 16*i;
-
-                        int kmax = 0;
-                        double amax = 0.0;
-                        for (int k = 0; k < 16; ++k) {
-                            if (m_rx.spectrum[bin + k] > amax) {
-                                kmax = k;
-                                amax = m_rx.spectrum[bin + k];
-                            }
-                        }
+        for (int i = 0; i < m_rx.protocols.size(); ++i) {
+            const auto & protocol = m_rx.protocols[i];
+            if (protocol.enabled == false) {
+                continue;
+            }
 
-                        if (i%2) {
-                            curByte += (kmax << 4);
-                            m_dataEncoded[itx*protocol.bytesPerTx + i/2] = curByte;
-                            curByte = 0;
-                        } else {
-                            curByte = kmax;
-                        }
-                    }
+            const int * bins = markerBins(i);
 
-                    if (itx*protocol.bytesPerTx > m_encodedDataOffset && knownLength == false) {
-                        RS::ReedSolomon rsLength(1, m_encodedDataOffset - 1, m_workRSLength.data());
-                        if ((rsLength.Decode(m_dataEncoded.data(), m_rx.data.data()) == 0) && (m_rx.data[0] > 0 && m_rx.data[0] <= 140)) {
-                            knownLength = true;
-                            decodedLength = m_rx.data[0];
-                            //printf("decoded length = %d, recvDuration_frames = %d\n", decodedLength, m_rx.recvDuration_frames);
-
-                            const int nTotalBytesExpected = m_encodedDataOffset + decodedLength + ::getECCBytesForLength(decodedLength);
-                            const int nTotalFramesExpected = 2*m_nMarkerFrames + ((nTotalBytesExpected + protocol.bytesPerTx - 1)/protocol.bytesPerTx)*protocol.framesPerTx;
-                            if (m_rx.recvDuration_frames > nTotalFramesExpected ||
-                                m_rx.recvDuration_frames < nTotalFramesExpected - 2*m_nMarkerFrames) {
-                                //printf("  - invalid number of frames: %d (expected %d)\n", m_rx.recvDuration_frames, nTotalFramesExpected);
-                                knownLength = false;
-                                break;
-                            }
-                        } else {
-                            break;
-                        }
-                    }
+            int nDetectedMarkerBits = m_nBitsInMarker;
 
-                    {
-                        const int nTotalBytesExpected = m_encodedDataOffset + decodedLength + ::getECCBytesForLength(decodedLength);
-                        if (knownLength && itx*protocol.bytesPerTx > nTotalBytesExpected + 1) {
-                            break;
-                        }
-                    }
+            for (int i = 0; i < m_nBitsInMarker; ++i) {
+                const int bin = bins[i];
+
+                if (i%2 == 0) {
+                    if (m_rx.spectrum[bin] >= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) nDetectedMarkerBits--;
+                } else {
+                    if (m_rx.spectrum[bin] <= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) nDetectedMarkerBits--;
                 }
+            }
 
-                if (knownLength) {
-                    RS::ReedSolomon rsData(decodedLength, ::getECCBytesForLength(decodedLength), m_workRSData.data());
-
-                    if (rsData.Decode(m_dataEncoded.data() + m_encodedDataOffset, m_rx.data.data()) == 0) {
-                        if (decodedLength > 0) {
-                            if (m_isDSSEnabled) {
-                                for (int i = 0; i < decodedLength; ++i) {
-                                    m_rx.data[i] = m_rx.data[i] ^ getDSSMagic(i);
-                                }
-                            }
-
-                            ggprintf("Decoded length = %d, protocol = '%s' (%d)\n", decodedLength, protocol.name, protocolId);
-                            ggprintf("Received sound data successfully: '%s'\n", m_rx.data.data());
-
-                            isValid = true;
-                            m_rx.hasNewRxData = true;
-                            m_rx.dataLength = decodedLength;
-                            m_rx.protocol = protocol;
-                            m_rx.protocolId = RxProtocolId(protocolId);
-                        }
-                    }
+            if (nDetectedMarkerBits == m_nBitsInMarker) {
+                isEnded = true;
+                break;
+            }
+        }
+
+        if (isEnded) {
+            if (++m_rx.nMarkersSuccess >= 1) {
+            } else {
+                isEnded = false;
+            }
+        } else {
+            m_rx.nMarkersSuccess = 0;
+        }
+
+        if (isEnded && m_rx.framesToRecord > 1) {
+            m_rx.recvDuration_frames -= m_rx.framesLeftToRecord - 1;
+            ggprintf("Received end marker. Frames left = %d, recorded = %d\n", m_rx.framesLeftToRecord, m_rx.recvDuration_frames);
+            m_rx.nMarkersSuccess = 0;
+            m_rx.framesLeftToRecord = 1;
+        }
+    }
+}
+
+bool GGWave::analyze() {
+    const int nOffsets = m_nMarkerFrames*kAnalysisStepsPerFrame;
+
+    auto & analysis = m_rx.analysis;
+    auto & worker = analysis.workers[0];
+    auto & stats = m_rx.analysisStats;
+
+    if (analysis.started == false) {
+        ggprintf("Analyzing captured data ..\n");
+
+        analysis.started    = true;
+        analysis.pass       = 0;
+        analysis.protocolId = 0;
+        analysis.candidate  = 0;
+        analysis.rankStep   = 0;
+        analysis.nRanked    = -1;
+
+        worker.itx   = 0;
+        worker.nFFTs = 0;
+
+        stats.nAnalyses++;
+        stats.nCandidatesLast = 0;
+
+        // every candidate protocol has nOffsets candidates in total over the two passes
+        m_rx.framesToAnalyze = 0;
+        for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
+            const auto & protocol = m_rx.protocols[protocolId];
+            if (protocol.enabled && protocol.extra != 2 && protocol.freqStart == analysis.markerFreqStart) {
+                m_rx.framesToAnalyze += nOffsets;
+            }
+        }
+        m_rx.framesLeftToAnalyze = m_rx.framesToAnalyze;
+
+        if (m_rxAnalysisCache) {
+            m_rx.analysisCacheBin0 = round(m_hzPerSample*analysis.markerFreqStart*m_ihzPerSample);
+            for (int i = 0; i < (int) m_rx.analysisCacheOffsets.size(); ++i) {
+                m_rx.analysisCacheOffsets[i] = -1;
+            }
+        }
+    }
+
+    // first pass  - only the offsets right after the end of the start marker
+    // second pass - all remaining offsets
+    bool isValid = false;
+    if (m_rxAnalysisWorkers > 1) {
+        isValid = analyzeParallel();
+    }
+
+    while (m_rxAnalysisWorkers == 1 && analysis.pass < 2) {
+        if (analysis.protocolId >= (int) m_rx.protocols.size()) {
+            analysis.pass++;
+            analysis.protocolId = 0;
+            analysis.candidate = 0;
+
+            if (analysis.pass == 1) {
+                stats.nFallbacks++;
+            }
+            continue;
+        }
+
+        const int protocolId = analysis.protocolId;
+        const auto & protocol = m_rx.protocols[protocolId];
+
+        // skip Rx protocol if it is disabled, mono-tone or its start frequency is different from the detected one
+        if (protocol.enabled == false || protocol.extra == 2 || protocol.freqStart != analysis.markerFreqStart) {
+            analysis.protocolId++;
+            continue;
+        }
+
+        if (analysis.pass == 0 && analysis.nRanked < 0) {
+            // all candidate protocols have the same start marker
+            analysis.nRanked = rankOffsets(protocol, analysis.offsets, kAnalysisCandidates);
+            if (analysis.nRanked < 0) {
+                return false;
+            }
+        }
+
+        // note : not sure if looping backwards here is more meaningful than looping forwards
+        const int nCandidates = analysis.pass == 0 ? analysis.nRanked : nOffsets;
+        if (analysis.candidate >= nCandidates) {
+            analysis.protocolId++;
+            analysis.candidate = 0;
+            continue;
+        }
+
+        const int ii = analysis.pass == 0 ? analysis.offsets[analysis.candidate] : nOffsets - 1 - analysis.candidate;
+
+        if (analysis.pass == 1) {
+            bool isRanked = false;
+            for (int j = 0; j < analysis.nRanked; ++j) {
+                isRanked |= analysis.offsets[j] == ii;
+            }
+            if (isRanked) {
+                analysis.candidate++;
+                continue;
+            }
+        }
+
+        if (analysis.candidate == 0 && worker.itx == 0) {
+            worker.spectrum.zero();
+        }
+
+        // the exhaustive scan transforms the same frames many times, so it benefits from the cache
+        const auto res = decodeOffset(0, protocolId, ii, analysis.pass == 1 && m_rxAnalysisCache);
+
+        stats.nFFTs += worker.nFFTs;
+        if (m_rxAnalysisBudget > 0) {
+            analysis.budgetLeft -= worker.nFFTs;
+        }
+        worker.nFFTs = 0;
+
+        if (res == kAnalysisPending) {
+            return false;
+        }
+
+        stats.nCandidatesLast++;
+
+        if (res == kAnalysisDecoded) {
+            isValid = true;
+            break;
+        }
+
+        --m_rx.framesLeftToAnalyze;
+        analysis.candidate++;
+    }
+
+    stats.nCandidates += stats.nCandidatesLast;
+
+    const auto protocolId = RxProtocolId(analysis.protocolId);
+
+    if (isValid) {
+        ggprintf("Decoded length = %d, protocol = '%s' (%d)\n", worker.decodedLength, m_rx.protocols[protocolId].name, protocolId);
+        ggprintf("Received sound data successfully: '%s'\n", worker.data.data());
+    } else {
+        ggprintf("Failed to capture sound data. Please try again (length = %d)\n", worker.data[0]);
+    }
+
+    analysis.started = false;
+
+    worker.spectrum.zero();
+
+    m_rx.framesToAnalyze = 0;
+    m_rx.framesLeftToAnalyze = 0;
+
+    if (m_rxAsyncAnalysis) {
+        // the decoding thread does not touch the results - they are passed only to the callback
+        if (m_rxCallback) {
+            m_rxCallback(isValid ? worker.data.data() : nullptr, isValid ? worker.decodedLength : -1, protocolId, m_rxCallbackUserData);
+        }
+
+        ::ggAtomicStore(&m_rx.analysisInFlight, 0);
+
+        return true;
+    }
+
+    m_rx.framesToRecord = 0;
+
+    if (isValid) {
+        m_rx.hasNewRxData = true;
+        m_rx.dataLength = worker.decodedLength;
+        m_rx.protocol = m_rx.protocols[protocolId];
+        m_rx.protocolId = protocolId;
+    } else {
+        m_rx.dataLength = -1;
+        m_rx.framesToRecord = -1;
+    }
+
+    m_rx.receiving = false;
+    m_rx.analyzing = false;
+
+    if (m_rxCallback) {
+        m_rxCallback(isValid ? worker.data.data() : nullptr, isValid ? worker.decodedLength : -1, protocolId, m_rxCallbackUserData);
+    }
+
+    return true;
+}
+
+bool GGWave::analyzeParallel() {
+    const int nOffsets = m_nMarkerFrames*kAnalysisStepsPerFrame;
+
+    auto & analysis = m_rx.analysis;
+    auto & stats = m_rx.analysisStats;
+
+    // list the candidates in the order in which the sequential analysis tries them
+    int nCandidates = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
+            const auto & protocol = m_rx.protocols[protocolId];
+            if (protocol.enabled == false || protocol.extra == 2 || protocol.freqStart != analysis.markerFreqStart) {
+                continue;
+            }
+
+            if (analysis.nRanked < 0) {
+                analysis.nRanked = rankOffsets(protocol, analysis.offsets, kAnalysisCandidates);
+            }
+
+            for (int i = 0; i < (pass == 0 ? analysis.nRanked : nOffsets); ++i) {
+                const int ii = pass == 0 ? analysis.offsets[i] : nOffsets - 1 - i;
+
+                bool isRanked = false;
+                for (int j = 0; pass == 1 && j < analysis.nRanked; ++j) {
+                    isRanked |= analysis.offsets[j] == ii;
                 }
 
-                if (isValid) {
-                    break;
+                if (isRanked == false) {
+                    analysis.candidates[nCandidates++] = protocolId*nOffsets + ii;
                 }
-                --m_rx.framesLeftToAnalyze;
             }
+        }
 
-            if (isValid) break;
+        if (pass == 0) {
+            analysis.nCandidates0 = nCandidates;
         }
+    }
 
-        m_rx.framesToRecord = 0;
+    analysis.nCandidates   = nCandidates;
+    analysis.nextCandidate = 0;
+    analysis.bestCandidate = nCandidates;
 
-        if (isValid == false) {
-            ggprintf("Failed to capture sound data. Please try again (length = %d)\n", m_rx.data[0]);
-            m_rx.dataLength = -1;
-            m_rx.framesToRecord = -1;
+    for (int i = 0; i < m_rxAnalysisWorkers; ++i) {
+        analysis.workers[i].itx              = 0;
+        analysis.workers[i].nFFTs            = 0;
+        analysis.workers[i].nCandidates      = 0;
+        analysis.workers[i].decodedCandidate = -1;
+    }
+
+    if (m_rxParallelExecutor) {
+        m_rxParallelExecutor(this, m_rxAnalysisWorkers, m_rxParallelExecutorUserData);
+    } else {
+        for (int i = 0; i < m_rxAnalysisWorkers; ++i) {
+            rxAnalysisWorker(i);
         }
+    }
 
-        m_rx.receiving = false;
-        m_rx.analyzing = false;
+    for (int i = 0; i < m_rxAnalysisWorkers; ++i) {
+        stats.nFFTs += analysis.workers[i].nFFTs;
+        stats.nCandidatesLast += analysis.workers[i].nCandidates;
+        analysis.workers[i].nFFTs = 0;
+    }
 
-        m_rx.spectrum.zero();
+    const int best = analysis.bestCandidate;
+    if (best >= analysis.nCandidates0) {
+        stats.nFallbacks++;
+    }
 
-        m_rx.framesToAnalyze = 0;
-        m_rx.framesLeftToAnalyze = 0;
+    if (best == nCandidates) {
+        return false;
     }
 
-    // check if receiving data
-    if (m_rx.receiving == false) {
-        bool isReceiving = false;
+    analysis.protocolId = analysis.candidates[best]/nOffsets;
 
-        for (int i = 0; i < m_rx.protocols.size(); ++i) {
-            const auto & protocol = m_rx.protocols[i];
-            if (protocol.enabled == false) {
-                continue;
+    // a worker stops after its first decoded candidate, so the result is still in its buffers
+    auto & worker = analysis.workers[0];
+    for (int i = 1; i < m_rxAnalysisWorkers; ++i) {
+        const auto & cur = analysis.workers[i];
+        if (cur.decodedCandidate == best) {
+            worker.decodedLength = cur.decodedLength;
+            worker.data.copy(cur.data);
+        }
+    }
+
+    return true;
+}
+
+void GGWave::rxAnalysisWorker(int iWorker) {
+    const int nOffsets = m_nMarkerFrames*kAnalysisStepsPerFrame;
+
+    auto & analysis = m_rx.analysis;
+    auto & worker = analysis.workers[iWorker];
+
+    while (true) {
+        const int i = ::ggAtomicFetchAdd(&analysis.nextCandidate, 1);
+
+        // the candidates after the first decoded one are not needed
+        if (i >= analysis.nCandidates || i > ::ggAtomicLoad(&analysis.bestCandidate)) {
+            break;
+        }
+
+        worker.nCandidates++;
+
+        // note : the analysis cache is shared, so the parallel workers do not use it
+        if (decodeOffset(iWorker, analysis.candidates[i]/nOffsets, analysis.candidates[i]%nOffsets, false) == kAnalysisDecoded) {
+            worker.decodedCandidate = i;
+            ::ggAtomicMin(&analysis.bestCandidate, i);
+        }
+    }
+}
+
+bool GGWave::handOffCapture() {
+    if (::ggAtomicLoad(&m_rx.analysisInFlight)) {
+        return false;
+    }
+
+    auto & analysis = m_rx.analysis;
+
+    // double buffering - the executor analyzes the completed recording, while the next one is recorded in the other buffer
+    RecordedData recorded(m_rx.amplitudeRecorded);
+    m_rx.amplitudeRecorded.assign(analysis.amplitudeRecorded);
+    analysis.amplitudeRecorded.assign(recorded);
+
+    RecordedI16 recordedI16(m_rx.amplitudeRecordedI16);
+    m_rx.amplitudeRecordedI16.assign(analysis.amplitudeRecordedI16);
+    analysis.amplitudeRecordedI16.assign(recordedI16);
+
+    analysis.markerFreqStart     = m_rx.markerFreqStart;
+    analysis.recvDuration_frames = m_rx.recvDuration_frames;
+
+    m_rx.captureReady   = false;
+    m_rx.receiving      = false;
+    m_rx.framesToRecord = 0;
+
+    ::ggAtomicStore(&m_rx.analysisInFlight, 1);
+
+    if (m_rxExecutor) {
+        m_rxExecutor(this, m_rxExecutorUserData);
+    } else {
+        rxAnalyzeCapture();
+    }
+
+    return true;
+}
+
+GGWave::AnalysisResult GGWave::decodeOffset(int iWorker, int protocolId, int offsetStart, bool useCache) {
+    const int stepsPerFrame = kAnalysisStepsPerFrame;
+    const int step = m_samplesPerFrame/stepsPerFrame;
+
+    const auto & protocol = m_rx.protocols[protocolId];
+
+    auto & analysis = m_rx.analysis;
+    auto & worker = analysis.workers[iWorker];
+
+    // the decoding state of the candidate is kept in the worker so that it can be resumed
+    int  & itx           = worker.itx;
+    bool & knownLength   = worker.knownLength;
+    int  & decodedLength = worker.decodedLength;
+
+    if (itx == 0) {
+        knownLength = false;
+        decodedLength = 0;
+        worker.itx0 = 0;
+        worker.nTxs = 0;
+    }
+
+    // the Tx i of the candidate is in the recording
+    const auto isRecorded = [&](int i) {
+        const int offsetTx = offsetStart + i*protocol.framesPerTx*stepsPerFrame;
+        if (offsetTx >= analysis.recvDuration_frames*stepsPerFrame || (i + 1)*protocol.bytesPerTx >= (int) worker.dataEncoded.size()) {
+            return false;
+        }
+
+        return offsetTx + protocol.framesPerTx*stepsPerFrame <= m_rx.recordedFrames*stepsPerFrame;
+    };
+
+    for (; itx < 1024; ++itx) {
+        int offsetTx = offsetStart + itx*protocol.framesPerTx*stepsPerFrame;
+        if (isRecorded(itx) == false) {
+            break;
+        }
+
+        if (m_rxAnalysisBudget > 0 && analysis.budgetLeft - worker.nFFTs <= 0) {
+            return kAnalysisPending;
+        }
+
+        if (useCache) {
+            // the FFT is linear - sum the spectra of the frames instead of transforming their sum
+            const int nBins = 2*16*protocol.bytesPerTx;
+
+            analysisCacheFill(offsetTx, protocol.framesPerTx);
+
+            float * sum = worker.fftOut.data();
+            memcpy(sum, analysisFrameSpectrum(offsetTx), 2*nBins*sizeof(float));
+
+            for (int k = 1; k < protocol.framesPerTx; ++k) {
+                const float * cur = analysisFrameSpectrum(offsetTx + k*stepsPerFrame);
+                for (int i = 0; i < 2*nBins; ++i) {
+                    sum[i] += cur[i];
+                }
             }
 
-            int nDetectedMarkerBits = m_nBitsInMarker;
+            // note : only the relative power of the bins is used below, so there is no need to add the mirrored half
+            const int bin0 = m_rx.analysisCacheBin0;
+            for (int i = 0; i < nBins; ++i) {
+                worker.spectrum[bin0 + i] = sum[2*i + 0]*sum[2*i + 0] + sum[2*i + 1]*sum[2*i + 1];
+            }
+        } else {
+            // the Txs up to the next check of the length are decoded in any case, so they are transformed in one batch
+            if (itx >= worker.itx0 + worker.nTxs) {
+                const int nBytesChecked = knownLength ? m_encodedDataOffset + decodedLength + ::getECCBytesForLength(decodedLength) + 1 : m_encodedDataOffset;
 
-            for (int i = 0; i < m_nBitsInMarker; ++i) {
-                double freq = bitFreq(protocol, i);
-                int bin = round(freq*m_ihzPerSample);
+                int nTxs = GG_MIN(nBytesChecked/protocol.bytesPerTx + 2 - itx, m_fftBatchFrames);
+                if (m_rxAnalysisBudget > 0) {
+                    nTxs = GG_MIN(nTxs, analysis.budgetLeft - worker.nFFTs);
+                }
+                nTxs = GG_MAX(nTxs, 1);
 
-                if (i%2 == 0) {
-                    if (m_rx.spectrum[bin] <= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) --nDetectedMarkerBits;
-                } else {
-                    if (m_rx.spectrum[bin] >= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) --nDetectedMarkerBits;
+                for (int i = 1; i < nTxs; ++i) {
+                    if (isRecorded(itx + i) == false) {
+                        nTxs = i;
+                        break;
+                    }
+                }
+
+                for (int i = 0; i < nTxs; ++i) {
+                    const int offsetCur = offsetTx + i*protocol.framesPerTx*stepsPerFrame;
+
+                    float * frame = worker.fftBatch.data() + i*m_samplesPerFrame;
+                    recordedCopy(offsetCur*step, frame);
+
+                    // note : should we skip the first and last frame here as they are amplitude-smoothed?
+                    for (int k = 1; k < protocol.framesPerTx; ++k) {
+                        recordedAdd((offsetCur + k*stepsPerFrame)*step, frame);
+                    }
                 }
+
+                FFTBatch(worker.fftBatch.data(), worker.fftBatch.data(), m_samplesPerFrame, nTxs, m_fft, m_fftBatch, worker.fftWork.data());
+                worker.nFFTs += nTxs;
+
+                worker.itx0 = itx;
+                worker.nTxs = nTxs;
             }
 
-            if (nDetectedMarkerBits == m_nBitsInMarker) {
-                m_rx.markerFreqStart = protocol.freqStart;
-                isReceiving = true;
-                break;
+            const float * fftOut = worker.fftBatch.data() + (itx - worker.itx0)*m_samplesPerFrame;
+
+            // only the data bins of the protocol are read below
+            const int bin0 = round(m_hzPerSample*protocol.freqStart*m_ihzPerSample);
+            powerSpectrum(fftOut, worker.spectrum.data(), m_samplesPerFrame, bin0, bin0 + 2*16*protocol.bytesPerTx);
+        }
+
+        uint8_t curByte = 0;
+        for (int i = 0; i < 2*protocol.bytesPerTx; ++i) {
+            double freq = m_hzPerSample*protocol.freqStart;
+            int bin = round(freq*m_ihzPerSample) + 16*i;
+
+            int kmax = 0;
+            double amax = 0.0;
+            for (int k = 0; k < 16; ++k) {
+                if (worker.spectrum[bin + k] > amax) {
+                    kmax = k;
+                    amax = worker.spectrum[bin + k];
+                }
+            }
+
+            if (i%2) {
+                curByte += (kmax << 4);
+                worker.dataEncoded[itx*protocol.bytesPerTx + i/2] = curByte;
+                curByte = 0;
+            } else {
+                curByte = kmax;
             }
         }
 
-        if (isReceiving) {
-            if (++m_rx.nMarkersSuccess >= 1) {
+        if (itx*protocol.bytesPerTx > m_encodedDataOffset && knownLength == false) {
+            RS::ReedSolomon rsLength(1, m_encodedDataOffset - 1, worker.workRSLength.data());
+            if ((rsLength.Decode(worker.dataEncoded.data(), worker.data.data()) == 0) && (worker.data[0] > 0 && worker.data[0] <= 140)) {
+                knownLength = true;
+                decodedLength = worker.data[0];
+                //printf("decoded length = %d, recvDuration_frames = %d\n", decodedLength, analysis.recvDuration_frames);
+
+                const int nTotalBytesExpected = m_encodedDataOffset + decodedLength + ::getECCBytesForLength(decodedLength);
+                const int nTotalFramesExpected = 2*m_nMarkerFrames + ((nTotalBytesExpected + protocol.bytesPerTx - 1)/protocol.bytesPerTx)*protocol.framesPerTx;
+                if (analysis.recvDuration_frames > nTotalFramesExpected ||
+                    analysis.recvDuration_frames < nTotalFramesExpected - 2*m_nMarkerFrames) {
+                    //printf("  - invalid number of frames: %d (expected %d)\n", analysis.recvDuration_frames, nTotalFramesExpected);
+                    knownLength = false;
+                    break;
+                }
             } else {
-                isReceiving = false;
+                break;
             }
-        } else {
-            m_rx.nMarkersSuccess = 0;
         }
 
-        if (isReceiving) {
-            ggprintf("Receiving sound data ...\n");
+        {
+            const int nTotalBytesExpected = m_encodedDataOffset + decodedLength + ::getECCBytesForLength(decodedLength);
+            if (knownLength && itx*protocol.bytesPerTx > nTotalBytesExpected + 1) {
+                break;
+            }
+        }
+    }
 
-            m_rx.receiving = true;
-            m_rx.data.zero();
+    // the next candidate starts from the beginning
+    itx = 0;
 
-            // max recieve duration
-            m_rx.recvDuration_frames =
-                2*m_nMarkerFrames +
-                maxFramesPerTx(m_rx.protocols, true)*(
-                        (kMaxLengthVariable + ::getECCBytesForLength(kMaxLengthVariable))/minBytesPerTx(m_rx.protocols) + 1
-                        );
+    if (knownLength) {
+        RS::ReedSolomon rsData(decodedLength, ::getECCBytesForLength(decodedLength), worker.workRSData.data());
+
+        if (rsData.Decode(worker.dataEncoded.data() + m_encodedDataOffset, worker.data.data()) == 0) {
+            if (decodedLength > 0) {
+                if (m_isDSSEnabled) {
+                    for (int i = 0; i < decodedLength; ++i) {
+                        worker.data[i] = worker.data[i] ^ getDSSMagic(i);
+                    }
+                }
+
+                return kAnalysisDecoded;
+            }
+        }
+    }
+
+    return kAnalysisFailed;
+}
+
+void GGWave::analysisCacheFill(int offset, int count) {
+    const int N    = m_samplesPerFrame;
+    const int step = N/kAnalysisStepsPerFrame;
+
+    const int nSlots = (int) m_rx.analysisCacheOffsets.size();
+
+    auto & analysis = m_rx.analysis;
+    auto & worker = analysis.workers[0];
+
+    float * work = m_rx.analysisCacheWork.data();
+
+    // the missing frames are transformed in batches
+    //   the frames of a Tx are less than kAnalysisCacheFrames apart, so they do not evict each other
+    int offsets[fft::kMaxLanes];
+    int nFrames = 0;
+
+    for (int k = 0; k < count; ++k) {
+        const int cur = offset + k*kAnalysisStepsPerFrame;
+
+        if (m_rx.analysisCacheOffsets[cur % nSlots] != cur) {
+            recordedCopy(cur*step, work + nFrames*N);
+            offsets[nFrames++] = cur;
+        }
+
+        if (nFrames == m_fftBatchFrames || (nFrames > 0 && k == count - 1)) {
+            FFTBatch(work, work, N, nFrames, m_fft, m_fftBatch, worker.fftWork.data());
+            worker.nFFTs += nFrames;
+
+            for (int i = 0; i < nFrames; ++i) {
+                const int slot = offsets[i] % nSlots;
+
+                auto spectrum = m_rx.analysisCacheSpectra[slot];
+
+                // the data bins of the high-frequency protocols can reach the Nyquist frequency
+                const int n = GG_MIN((int) spectrum.size(), N - 2*m_rx.analysisCacheBin0);
+
+                spectrum.zero();
+                memcpy(spectrum.data(), work + i*N + 2*m_rx.analysisCacheBin0, n*sizeof(float));
+                m_rx.analysisCacheOffsets[slot] = offsets[i];
+            }
+
+            nFrames = 0;
+        }
+    }
+}
+
+const float * GGWave::analysisFrameSpectrum(int offset) {
+    // direct-mapped - frames that are kAnalysisCacheFrames apart share a slot
+    const int slot = offset % (int) m_rx.analysisCacheOffsets.size();
+
+    return m_rx.analysisCacheSpectra[slot].data();
+}
 
-            m_rx.nMarkersSuccess = 0;
-            m_rx.framesToRecord = m_rx.recvDuration_frames;
-            m_rx.framesLeftToRecord = m_rx.recvDuration_frames;
-        }
-    } else {
-        bool isEnded = false;
+int GGWave::rankOffsets(const RxProtocol & protocol, int * offsets, int nOffsetsMax) {
+    const int N        = m_samplesPerFrame;
+    const int step     = N/kAnalysisStepsPerFrame;
+    const int nOffsets = m_nMarkerFrames*kAnalysisStepsPerFrame;
+    const int nBins    = 2*m_nBitsInMarker;
 
-        for (int i = 0; i < m_rx.protocols.size(); ++i) {
-            const auto & protocol = m_rx.protocols[i];
-            if (protocol.enabled == false) {
-                continue;
-            }
+    double * re = m_rx.markerDFT.data();
+    double * im = re + nBins;
+    double * wr = im + nBins;
+    double * wi = wr + nBins;
 
-            int nDetectedMarkerBits = m_nBitsInMarker;
+    auto & analysis = m_rx.analysis;
 
-            for (int i = 0; i < m_nBitsInMarker; ++i) {
-                double freq = bitFreq(protocol, i);
-                int bin = round(freq*m_ihzPerSample);
+    // each marker bit is a pair of bins - the first one is louder for the even bits of the start marker
+    for (int i = 0; i < m_nBitsInMarker && analysis.rankStep == 0; ++i) {
+        const int bin = round(bitFreq(protocol, i)*m_ihzPerSample);
+        for (int j = 0; j < 2; ++j) {
+            const double phi = 2.0*M_PI*(bin + j*m_freqDelta_bin)/N;
 
-                if (i%2 == 0) {
-                    if (m_rx.spectrum[bin] >= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) nDetectedMarkerBits--;
-                } else {
-                    if (m_rx.spectrum[bin] <= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) nDetectedMarkerBits--;
-                }
-            }
+            re[2*i + j] = 0.0;
+            im[2*i + j] = 0.0;
+            wr[2*i + j] = cos(phi);
+            wi[2*i + j] = sin(phi);
+        }
+    }
 
-            if (nDetectedMarkerBits == m_nBitsInMarker) {
-                isEnded = true;
-                break;
+    // sliding DFT of the marker bins over the window [t, t + N):
+    //
+    //   X(t + 1) = (X(t) - x[t] + x[t + N])*exp(i*2*pi*k/N)
+    //
+    // starting with an empty window at t = -N
+    //
+    const float   * x    = analysis.amplitudeRecorded.data();
+    const int16_t * xI16 = analysis.amplitudeRecordedI16.data();
+
+    // sliding the window by kAnalysisRankStepsPerFFT steps costs about as much as one FFT
+    int t = analysis.rankStep == 0 ? -N : (analysis.rankStep - 1)*step;
+    for (int s = analysis.rankStep; s < nOffsets; ++s) {
+        const int cost = s == 0 ? kAnalysisStepsPerFrame/kAnalysisRankStepsPerFFT : (s % kAnalysisRankStepsPerFFT == 0);
+        if (m_rxAnalysisBudget > 0) {
+            if (cost > 0 && analysis.budgetLeft <= 0) {
+                analysis.rankStep = s;
+                return -1;
             }
+            analysis.budgetLeft -= cost;
         }
 
-        if (isEnded) {
-            if (++m_rx.nMarkersSuccess >= 1) {
+        for (; t < s*step; ++t) {
+            double dx = 0.0;
+            if (m_rxRecordI16) {
+                dx = (xI16[t + N] - (t >= 0 ? xI16[t] : 0))*(1.0/32768.0);
             } else {
-                isEnded = false;
+                dx = x[t + N] - (t >= 0 ? x[t] : 0.0f);
+            }
+            for (int k = 0; k < nBins; ++k) {
+                const double r = re[k] + dx;
+                re[k] = r*wr[k] - im[k]*wi[k];
+                im[k] = r*wi[k] + im[k]*wr[k];
             }
-        } else {
-            m_rx.nMarkersSuccess = 0;
         }
 
-        if (isEnded && m_rx.framesToRecord > 1) {
-            m_rx.recvDuration_frames -= m_rx.framesLeftToRecord - 1;
-            ggprintf("Received end marker. Frames left = %d, recorded = %d\n", m_rx.framesLeftToRecord, m_rx.recvDuration_frames);
-            m_rx.nMarkersSuccess = 0;
-            m_rx.framesLeftToRecord = 1;
+        // average contrast of the marker bits in the window starting at step s: 1 for a clean start marker
+        double score = 0.0;
+        for (int i = 0; i < m_nBitsInMarker; ++i) {
+            const double p0 = re[2*i + 0]*re[2*i + 0] + im[2*i + 0]*im[2*i + 0];
+            const double p1 = re[2*i + 1]*re[2*i + 1] + im[2*i + 1]*im[2*i + 1];
+            const double c  = (p0 - p1)/(p0 + p1 + 1e-20);
+
+            score += i%2 == 0 ? c : -c;
+        }
+
+        m_rx.markerScore[s] = score/m_nBitsInMarker;
+    }
+
+    // the data starts at offset s if the frame before s is all marker and the frame at s has no marker
+    // the frame before the first recorded frame is assumed to be marker
+    for (int s = nOffsets - 1; s >= 0; --s) {
+        m_rx.markerScore[s] = (s >= kAnalysisStepsPerFrame ? m_rx.markerScore[s - kAnalysisStepsPerFrame] : 1.0f) - m_rx.markerScore[s];
+    }
+
+    // select the best offsets - on ties, prefer the later ones
+    int n = 0;
+    for (; n < nOffsetsMax && n < nOffsets; ++n) {
+        int best = -1;
+        for (int s = nOffsets - 1; s >= 0; --s) {
+            bool isSelected = false;
+            for (int i = 0; i < n; ++i) {
+                isSelected |= offsets[i] == s;
+            }
+
+            if (isSelected == false && (best < 0 || m_rx.markerScore[s] > m_rx.markerScore[best])) {
+                best = s;
+            }
         }
+        offsets[n] = best;
     }
+
+    return n;
 }
 
 //
@@ -1878,17 +3113,14 @@ void GGWave::decode_fixed() {
     m_rx.hasNewSpectrum = true;
 
     // calculate spectrum
-    FFT(m_rx.amplitude.data(), m_rx.fftOut.data(), m_samplesPerFrame, m_rx.fftWorkI.data(), m_rx.fftWorkF.data());
+    int bin0, bin1;
+    spectrumBand(bin0, bin1);
+    FFTBand(m_rx.amplitude.data(), m_rx.fftOut.data(), m_samplesPerFrame, bin0, bin1, m_fft, m_fftBand, m_rx.fftWork.data());
+    powerSpectrum(m_rx.fftOut.data(), m_rx.spectrum.data(), m_samplesPerFrame, bin0, bin1);
 
     float amax = 0.0f;
-    for (int i = 0; i < m_samplesPerFrame; ++i) {
-        m_rx.spectrum[i] = (m_rx.fftOut[2*i + 0]*m_rx.fftOut[2*i + 0] + m_rx.fftOut[2*i + 1]*m_rx.fftOut[2*i + 1]);
-    }
-    for (int i = 1; i < m_samplesPerFrame/2; ++i) {
-        m_rx.spectrum[i] += m_rx.spectrum[m_samplesPerFrame - i];
-        if (i >= m_rx.minFreqStart) {
-            amax = GG_MAX(amax, m_rx.spectrum[i]);
-        }
+    for (int i = GG_MAX(1, bin0); i < bin1; ++i) {
+        amax = GG_MAX(amax, m_rx.spectrum[i]);
     }
 
     // original, floating-point version
@@ -1896,7 +3128,7 @@ void GGWave::decode_fixed() {
 
     // float -> uint8_t
     amax = 255.0f/(amax == 0.0f ? 1.0f : amax);
-    for (int i = 0; i < m_samplesPerFrame; ++i) {
+    for (int i = bin0; i < bin1; ++i) {
         m_rx.spectrumHistoryFixed[m_rx.historyIdFixed][i] = GG_MIN(255.0f, GG_MAX(0.0f, (float) round(m_rx.spectrum[i]*amax)));
     }
 
@@ -1910,138 +3142,362 @@ void GGWave::decode_fixed() {
         m_rx.historyIdFixed = 0;
     }
 
+    const int totalLength = m_payloadLength + getECCBytesForLength(m_payloadLength);
+
     bool isValid = false;
     for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
         const auto & protocol = m_rx.protocols[protocolId];
-        if (protocol.enabled == false) {
+        auto & votesProtocol = m_rx.votesFixedProtocol[protocolId];
+
+        // the votes of the protocols that do not fit in the buffers are not tracked
+        //   the empty protocol slots have no bytes per Tx, so the number of Txs is computed for the enabled protocols only
+        if (protocol.enabled == false ||
+            protocol.freqStart > m_samplesPerFrame ||
+            protocol.nTones() > m_rx.nTonesFixed) {
+            votesProtocol.enabled = false;
             continue;
         }
 
-        const int binStart = protocol.freqStart;
-        const int binDelta = 16;
-        const int binOffset = protocol.extra == 1 ? binDelta : 0;
+        const int totalTxs = protocol.extra*((totalLength + protocol.bytesPerTx - 1)/protocol.bytesPerTx);
 
-        if (binStart > m_samplesPerFrame) {
+        if (totalTxs > m_rx.nTxsFixed ||
+            totalTxs*protocol.framesPerTx > m_rx.spectrumHistoryFixed.size()) {
+            votesProtocol.enabled = false;
             continue;
         }
 
-        const int totalLength = m_payloadLength + getECCBytesForLength(m_payloadLength);
-        const int totalTxs = protocol.extra*((totalLength + protocol.bytesPerTx - 1)/protocol.bytesPerTx);
+        if (votesProtocol.enabled &&
+            votesProtocol.freqStart   == protocol.freqStart &&
+            votesProtocol.framesPerTx == protocol.framesPerTx &&
+            votesProtocol.bytesPerTx  == protocol.bytesPerTx &&
+            votesProtocol.extra       == protocol.extra) {
+            votesFixedUpdate(protocolId);
+        } else {
+            votesFixedRebuild(protocolId);
+        }
+
+        // the votes of all protocols are kept up to date, but only the first protocol that decodes is used
+        if (isValid) {
+            continue;
+        }
 
-        int historyStartId = m_rx.historyIdFixed - totalTxs*protocol.framesPerTx;
-        if (historyStartId < 0) {
-            historyStartId += m_rx.spectrumHistoryFixed.size();
+        if (m_rx.detectedFixed[protocolId] < 0.75*2*totalLength) {
+            continue;
         }
 
-        const int nTones = 2*protocol.bytesPerTx;
-        m_rx.detectedBins.zero();
+        const int8_t * majority = m_rx.majorityFixed[protocolId].data();
 
-        int txNeededTotal   = 0;
-        int txDetectedTotal = 0;
-        bool detectedSignal = true;
+        for (int j = 0; j < totalLength; ++j) {
+            const int tx   = protocol.extra*(j/protocol.bytesPerTx);
+            const int byte = j%protocol.bytesPerTx;
 
-        for (int k = 0; k < totalTxs; ++k) {
-            if (k % protocol.extra == 0) {
-                m_rx.detectedTones.zero(16*nTones);
-            }
+            // mono-tone protocols transmit the high nibble in the Tx after the low one
+            const int idx0 = protocol.extra == 1 ? tx*m_rx.nTonesFixed + 2*byte + 0 : (tx + 0)*m_rx.nTonesFixed + byte;
+            const int idx1 = protocol.extra == 1 ? tx*m_rx.nTonesFixed + 2*byte + 1 : (tx + 1)*m_rx.nTonesFixed + byte;
+
+            const int bin0 = GG_MAX(0, majority[idx0]);
+            const int bin1 = GG_MAX(0, majority[idx1]);
+
+            m_rx.dataEncoded[j] = (bin1 << 4) + bin0;
+        }
 
-            for (int i = 0; i < protocol.framesPerTx; ++i) {
-                int historyId = historyStartId + k*protocol.framesPerTx + i;
-                if (historyId >= (int) m_rx.spectrumHistoryFixed.size()) {
-                    historyId -= m_rx.spectrumHistoryFixed.size();
+        RS::ReedSolomon rsData(m_payloadLength, getECCBytesForLength(m_payloadLength), m_workRSData.data());
+
+        if (rsData.Decode(m_rx.dataEncoded.data(), m_rx.data.data()) == 0) {
+            if (m_isDSSEnabled) {
+                for (int i = 0; i < m_payloadLength; ++i) {
+                    m_rx.data[i] = m_rx.data[i] ^ getDSSMagic(i);
                 }
+            }
 
-                for (int j = 0; j < protocol.bytesPerTx; ++j) {
-                    int f0bin = 0;
-                    auto f0max = m_rx.spectrumHistoryFixed[historyId][binStart + 2*j*binDelta];
+            ggprintf("Decoded length = %d, protocol = '%s' (%d)\n", m_payloadLength, protocol.name, protocolId);
+            ggprintf("Received sound data successfully: '%s'\n", m_rx.data.data());
 
-                    for (int b = 1; b < 16; ++b) {
-                        {
-                            const auto & v = m_rx.spectrumHistoryFixed[historyId][binStart + 2*j*binDelta + b];
+            isValid = true;
+            m_rx.hasNewRxData = true;
+            m_rx.dataLength = m_payloadLength;
+            m_rx.protocol = protocol;
+            m_rx.protocolId = RxProtocolId(protocolId);
+        }
+    }
+}
 
-                            if (f0max <= v) {
-                                f0max = v;
-                                f0bin = b;
-                            }
-                        }
-                    }
+void GGWave::votesFixedTones(int protocolId, int historyId) {
+    const auto & protocol = m_rx.protocols[protocolId];
 
-                    int f1bin = 0;
-                    if (protocol.extra == 1) {
-                        auto f1max = m_rx.spectrumHistoryFixed[historyId][binStart + 2*j*binDelta + binOffset];
-                        for (int b = 1; b < 16; ++b) {
-                            const auto & v = m_rx.spectrumHistoryFixed[historyId][binStart + 2*j*binDelta + binOffset + b];
+    const uint8_t * spectrum = m_rx.spectrumHistoryFixed[historyId].data();
+    uint8_t * tones = m_rx.tonesFixed[historyId].data() + protocolId*m_rx.nTonesFixed;
 
-                            if (f1max <= v) {
-                                f1max = v;
-                                f1bin = b;
-                            }
-                        }
-                    } else {
-                        f1bin = f0bin;
-                    }
+    // the two nibbles of a byte use adjacent groups of 16 bins, except for the mono-tone protocols
+    // which transmit them in the same bins
+    const int binStep = 16*protocol.extra;
 
-                    if ((k + 0)%protocol.extra == 0) m_rx.detectedTones[(2*j + 0)*16 + f0bin]++;
-                    if ((k + 1)%protocol.extra == 0) m_rx.detectedTones[(2*j + 1)*16 + f1bin]++;
-                }
+    for (int t = 0; t < protocol.nTones(); ++t) {
+        const uint8_t * v = spectrum + protocol.freqStart + t*binStep;
+
+        int bin = 0;
+        for (int b = 1; b < 16; ++b) {
+            if (v[bin] <= v[b]) {
+                bin = b;
             }
+        }
+
+        tones[t] = bin;
+    }
+}
 
-            if (protocol.extra > 1 && (k % protocol.extra == 0)) continue;
+void GGWave::votesFixedAdd(int protocolId, int tx, int historyId, int delta) {
+    const auto & protocol = m_rx.protocols[protocolId];
 
-            int txNeeded = 0;
-            int txDetected = 0;
-            for (int j = 0; j < protocol.bytesPerTx; ++j) {
-                if ((k/protocol.extra)*protocol.bytesPerTx + j >= totalLength) break;
-                txNeeded += 2;
-                for (int b = 0; b < 16; ++b) {
-                    if (m_rx.detectedTones[(2*j + 0)*16 + b] > protocol.framesPerTx/2) {
-                        m_rx.detectedBins[2*((k/protocol.extra)*protocol.bytesPerTx + j) + 0] = b;
-                        txDetected++;
-                    }
-                    if (m_rx.detectedTones[(2*j + 1)*16 + b] > protocol.framesPerTx/2) {
-                        m_rx.detectedBins[2*((k/protocol.extra)*protocol.bytesPerTx + j) + 1] = b;
-                        txDetected++;
-                    }
-                }
+    const int totalLength = m_payloadLength + getECCBytesForLength(m_payloadLength);
+    const int threshold   = protocol.framesPerTx/2;
+
+    // the last chunk of the payload may use only some of the tones
+    const int nBytesLeft   = totalLength - (tx/protocol.extra)*protocol.bytesPerTx;
+    const int nTonesNeeded = GG_MIN(protocol.nTones(), (2/protocol.extra)*nBytesLeft);
+
+    const uint8_t * tones    = m_rx.tonesFixed[historyId].data() + protocolId*m_rx.nTonesFixed;
+    uint8_t       * votes    = m_rx.votesFixed[protocolId].data() + 16*tx*m_rx.nTonesFixed;
+    int8_t        * majority = m_rx.majorityFixed[protocolId].data() + tx*m_rx.nTonesFixed;
+
+    for (int t = 0; t < protocol.nTones(); ++t) {
+        const int bin = tones[t];
+        const int n   = votes[16*t + bin] + delta;
+
+        votes[16*t + bin] = n;
+
+        // at most one bin can have more than half of the votes
+        if (n > threshold && majority[t] != bin) {
+            majority[t] = bin;
+            if (t < nTonesNeeded) {
+                ++m_rx.detectedFixed[protocolId];
+            }
+        } else if (n <= threshold && majority[t] == bin) {
+            majority[t] = -1;
+            if (t < nTonesNeeded) {
+                --m_rx.detectedFixed[protocolId];
             }
+        }
+    }
+}
+
+void GGWave::votesFixedRebuild(int protocolId) {
+    const auto & protocol = m_rx.protocols[protocolId];
+
+    const int totalLength = m_payloadLength + getECCBytesForLength(m_payloadLength);
+    const int totalTxs    = protocol.extra*((totalLength + protocol.bytesPerTx - 1)/protocol.bytesPerTx);
+    const int nHistory    = m_rx.spectrumHistoryFixed.size();
+
+    m_rx.votesFixed[protocolId].zero();
+    memset(m_rx.majorityFixed[protocolId].data(), -1, m_rx.majorityFixed[protocolId].size());
+    m_rx.detectedFixed[protocolId] = 0;
 
-            txDetectedTotal += txDetected;
-            txNeededTotal += txNeeded;
+    const int historyStartId = (m_rx.historyIdFixed - totalTxs*protocol.framesPerTx + nHistory) % nHistory;
+
+    for (int k = 0; k < totalTxs; ++k) {
+        for (int i = 0; i < protocol.framesPerTx; ++i) {
+            const int historyId = (historyStartId + k*protocol.framesPerTx + i) % nHistory;
+
+            votesFixedTones(protocolId, historyId);
+            votesFixedAdd(protocolId, k, historyId, 1);
+        }
+    }
+
+    m_rx.votesFixedProtocol[protocolId] = protocol;
+}
+
+void GGWave::votesFixedUpdate(int protocolId) {
+    const auto & protocol = m_rx.protocols[protocolId];
+
+    const int totalLength = m_payloadLength + getECCBytesForLength(m_payloadLength);
+    const int totalTxs    = protocol.extra*((totalLength + protocol.bytesPerTx - 1)/protocol.bytesPerTx);
+    const int nHistory    = m_rx.spectrumHistoryFixed.size();
+
+    // the newest frame and the start of the window before it was added
+    const int historyNewId   = (m_rx.historyIdFixed - 1 + nHistory) % nHistory;
+    const int historyStartId = (historyNewId - totalTxs*protocol.framesPerTx + nHistory) % nHistory;
+
+    // the first frame of each Tx moves to the previous Tx - the first frame of the window is dropped and
+    // the newest frame is added to the last Tx. The newest frame may take the place of the dropped one,
+    // so its tones are computed after the retirement
+    for (int k = 0; k < totalTxs; ++k) {
+        votesFixedAdd(protocolId, k, (historyStartId + k*protocol.framesPerTx) % nHistory, -1);
+    }
+
+    votesFixedTones(protocolId, historyNewId);
+
+    for (int k = 0; k < totalTxs; ++k) {
+        votesFixedAdd(protocolId, k, (historyStartId + (k + 1)*protocol.framesPerTx) % nHistory, 1);
+    }
+}
+
+GGWave::ToneTables & GGWave::txToneTables() {
+    return m_tx.toneTablesShared ? *m_tx.toneTablesShared : m_tx.toneTables;
+}
+
+void GGWave::txUpdateToneTables() {
+    auto & tables = txToneTables();
+
+    if (tables.freqStart       == m_tx.protocol.freqStart &&
+        tables.bytesPerTx      == m_tx.protocol.bytesPerTx &&
+        tables.sampleRate      == m_sampleRate &&
+        tables.samplesPerFrame == m_samplesPerFrame) {
+        return;
+    }
+
+    // only the first 16*bytesPerTx tones are used by the protocol (this includes the 16 marker tones)
+    const int nRows = 2*m_tx.protocol.nDataBitsPerTx();
+
+    for (int k = 0; k < nRows; ++k) {
+        tables.phaseOffsets[k] = (M_PI*k)/(m_tx.protocol.nDataBitsPerTx());
+    }
+
+    // note : what is the purpose of this shuffle ? I forgot .. :(
+    //std::random_device rd;
+    //std::mt19937 g(rd());
+
+    //std::shuffle(phaseOffsets.begin(), phaseOffsets.end(), g);
+
+    if (m_txNCO) {
+        // tone k completes freqStart + k cycles per frame and starts with the phase offset of row k/2
+        for (int k = 0; k < 2*nRows; ++k) {
+            const double w = (2.0*M_PI)*(m_tx.protocol.freqStart + k)/m_samplesPerFrame;
+            const double phaseOffset = tables.phaseOffsets[k/2];
+
+            tables.oscCoeff[k] = 2.0*cos(kOscLanes*w);
+            for (int j = 0; j < 2*kOscLanes; ++j) {
+                tables.oscInit[2*kOscLanes*k + j] = sin(phaseOffset + (j - kOscLanes)*w);
+            }
         }
+    } else {
+        for (int k = 0; k < nRows; ++k) {
+            const double freq = bitFreq(m_tx.protocol, k);
+
+            const double phaseOffset = tables.phaseOffsets[k];
+            const double curHzPerSample = m_hzPerSample;
+            const double curIHzPerSample = 1.0/curHzPerSample;
+
+            for (int i = 0; i < m_samplesPerFrame; i++) {
+                const double curi = i;
+                tables.bit1Amplitude[k][i] = sin((2.0*M_PI)*(curi*m_isamplesPerFrame)*(freq*curIHzPerSample) + phaseOffset);
+            }
 
-        if (txDetectedTotal < 0.75*txNeededTotal) {
-            detectedSignal = false;
+            for (int i = 0; i < m_samplesPerFrame; i++) {
+                const double curi = i;
+                tables.bit0Amplitude[k][i] = sin((2.0*M_PI)*(curi*m_isamplesPerFrame)*((freq + m_hzPerSample*m_freqDelta_bin)*curIHzPerSample) + phaseOffset);
+            }
         }
+    }
+
+    tables.freqStart       = m_tx.protocol.freqStart;
+    tables.bytesPerTx      = m_tx.protocol.bytesPerTx;
+    tables.sampleRate      = m_sampleRate;
+    tables.samplesPerFrame = m_samplesPerFrame;
+}
+
+GGWave::Amplitude GGWave::txTone(int k) {
+    auto & tables = txToneTables();
+
+    if (m_txNCO == false) {
+        return k%2 ? tables.bit0Amplitude[k/2] : tables.bit1Amplitude[k/2];
+    }
+
+    // recursive sine oscillator: s[i + L] = 2*cos(L*w)*s[i] - s[i - L]
+    // the L interleaved lanes are independent, which shortens the dependency chain
+    const double c = tables.oscCoeff[k];
 
-        if (detectedSignal) {
-            RS::ReedSolomon rsData(m_payloadLength, getECCBytesForLength(m_payloadLength), m_workRSData.data());
+    double s[2*kOscLanes];
+    for (int j = 0; j < 2*kOscLanes; ++j) {
+        s[j] = tables.oscInit[2*kOscLanes*k + j];
+    }
 
-            for (int j = 0; j < totalLength; ++j) {
-                m_dataEncoded[j] = (m_rx.detectedBins[2*j + 1] << 4) + m_rx.detectedBins[2*j + 0];
+    for (int i = 0; i < m_samplesPerFrame; i += kOscLanes) {
+        for (int j = 0; j < kOscLanes; ++j) {
+            if (i + j < m_samplesPerFrame) {
+                m_tx.tone[i + j] = s[kOscLanes + j];
             }
 
-            if (rsData.Decode(m_dataEncoded.data(), m_rx.data.data()) == 0) {
-                if (m_isDSSEnabled) {
-                    for (int i = 0; i < m_payloadLength; ++i) {
-                        m_rx.data[i] = m_rx.data[i] ^ getDSSMagic(i);
-                    }
-                }
+            const double sn = c*s[kOscLanes + j] - s[j];
+            s[j] = s[kOscLanes + j];
+            s[kOscLanes + j] = sn;
+        }
+    }
+
+    return m_tx.tone;
+}
+
+const float * GGWave::txEnvelope(int cycleMod, int nPerCycle) {
+    if (m_tx.envelopeCycleMod != cycleMod || m_tx.envelopeNPerCycle != nPerCycle) {
+        ::computeAmplitudeEnvelope(m_tx.envelope.data(), m_samplesPerFrame, cycleMod, nPerCycle);
+
+        m_tx.envelopeCycleMod  = cycleMod;
+        m_tx.envelopeNPerCycle = nPerCycle;
+    }
+
+    return m_tx.envelope.data();
+}
+
+void GGWave::txUpdateToneSymbols() {
+    const auto & kernels = simd::kernels();
+
+    auto & symbols = m_tx.toneSymbols;
+
+    if (symbols.freqStart   == m_tx.protocol.freqStart &&
+        symbols.framesPerTx == m_tx.protocol.framesPerTx &&
+        symbols.bytesPerTx  == m_tx.protocol.bytesPerTx &&
+        symbols.volume      == m_tx.sendVolume) {
+        return;
+    }
+
+    const int nTones = 2*16*m_tx.protocol.bytesPerTx;
+
+    // the data tones are precomputed for each envelope class
+    int nClasses = 1;
+    bool hasFlat = false;
+    for (int j = 0; j < m_tx.protocol.framesPerTx; ++j) {
+        const bool isRamp = ::isAmplitudeRamp(m_samplesPerFrame, j, m_tx.protocol.framesPerTx);
+        const int classId = isRamp ? nClasses++ : 0;
 
-                ggprintf("Decoded length = %d, protocol = '%s' (%d)\n", m_payloadLength, protocol.name, protocolId);
-                ggprintf("Received sound data successfully: '%s'\n", m_rx.data.data());
+        symbols.envelopeClass[j] = classId;
 
-                isValid = true;
-                m_rx.hasNewRxData = true;
-                m_rx.dataLength = m_payloadLength;
-                m_rx.protocol = protocol;
-                m_rx.protocolId = RxProtocolId(protocolId);
+        if (isRamp == false) {
+            if (hasFlat) {
+                continue;
             }
+            hasFlat = true;
         }
 
-        if (isValid) {
-            break;
+        const float * envelope = txEnvelope(j, m_tx.protocol.framesPerTx);
+        for (int k = 0; k < nTones; ++k) {
+            auto dst = symbols.tones[classId*symbols.nTones + k];
+            dst.zero();
+            kernels.accumulate(dst.data(), txTone(k).data(), m_tx.sendVolume, envelope, m_samplesPerFrame);
+        }
+    }
+
+    // the marker frames are fully synthesized
+    const float scale = 1.0f/m_nBitsInMarker;
+    for (int frameId = 0; frameId < m_nMarkerFrames; ++frameId) {
+        auto dstStart = symbols.markers[frameId];
+        auto dstEnd   = symbols.markers[m_nMarkerFrames + frameId];
+
+        dstStart.zero();
+        dstEnd.zero();
+
+        const float * envelope = txEnvelope(frameId, m_nMarkerFrames);
+        for (int i = 0; i < m_nBitsInMarker; ++i) {
+            kernels.accumulate(dstStart.data(), txTone(2*i + i%2).data(),       m_tx.sendVolume, envelope, m_samplesPerFrame);
+            kernels.accumulate(dstEnd.data(),   txTone(2*i + (1 - i%2)).data(), m_tx.sendVolume, envelope, m_samplesPerFrame);
         }
+
+        kernels.scale(dstStart.data(), scale, m_samplesPerFrame);
+        kernels.scale(dstEnd.data(),   scale, m_samplesPerFrame);
     }
+
+    symbols.freqStart   = m_tx.protocol.freqStart;
+    symbols.framesPerTx = m_tx.protocol.framesPerTx;
+    symbols.bytesPerTx  = m_tx.protocol.bytesPerTx;
+    symbols.volume      = m_tx.sendVolume;
 }
 
 int GGWave::maxFramesPerTx(const Protocols & protocols, bool excludeMT) const {
@@ -2060,15 +3516,22 @@ int GGWave::maxFramesPerTx(const Protocols & protocols, bool excludeMT) const {
 }
 
 int GGWave::minBytesPerTx(const Protocols & protocols) const {
-    int res = 1;
+    int res = 0;
     for (int i = 0; i < protocols.size(); ++i) {
         const auto & protocol = protocols[i];
         if (protocol.enabled == false) {
             continue;
         }
-        res = GG_MIN(res, (int) protocol.bytesPerTx);
+        res = res == 0 ? protocol.bytesPerTx : GG_MIN(res, (int) protocol.bytesPerTx);
     }
-    return res;
+    return GG_MAX(1, res);
+}
+
+int GGWave::maxRecvDurationFrames(const Protocols & protocols) const {
+    return 2*m_nMarkerFrames +
+        maxFramesPerTx(protocols, true)*(
+                (kMaxLengthVariable + ::getECCBytesForLength(kMaxLengthVariable))/minBytesPerTx(protocols) + 1
+                );
 }
 
 int GGWave::maxBytesPerTx(const Protocols & protocols) const {
@@ -2107,6 +3570,162 @@ int GGWave::minFreqStart(const Protocols & protocols) const {
     return res;
 }
 
+// end of the highest marker or data bins of the protocols
+int GGWave::maxFreqEnd(const Protocols & protocols) const {
+    int res = 0;
+    for (int i = 0; i < protocols.size(); ++i) {
+        const auto & protocol = protocols[i];
+        if (protocol.enabled == false) {
+            continue;
+        }
+        res = GG_MAX(res, protocol.freqStart + GG_MAX(m_nBitsInMarker*m_freqDelta_bin + 1, 2*16*protocol.bytesPerTx));
+    }
+    return GG_MIN(res, m_samplesPerFrame);
+}
+
+int GGWave::maxEnvelopeClasses(const Protocols & protocols) const {
+    int res = 1;
+    for (int i = 0; i < protocols.size(); ++i) {
+        const auto & protocol = protocols[i];
+        if (protocol.enabled == false) {
+            continue;
+        }
+        int nClasses = 1;
+        for (int j = 0; j < protocol.framesPerTx; ++j) {
+            if (::isAmplitudeRamp(m_samplesPerFrame, j, protocol.framesPerTx)) {
+                ++nClasses;
+            }
+        }
+        res = GG_MAX(res, nClasses);
+    }
+    return res;
+}
+
 double GGWave::bitFreq(const Protocol & p, int bit) const {
     return m_hzPerSample*p.freqStart + m_freqDelta_hz*bit;
 }
+
+void GGWave::recordedCopy(int offset, float * dst) const {
+    const auto & analysis = m_rx.analysis;
+
+    if (m_rxRecordI16) {
+        const int16_t * src = analysis.amplitudeRecordedI16.data() + offset;
+        for (int i = 0; i < m_samplesPerFrame; ++i) {
+            dst[i] = src[i]*(1.0f/32768.0f);
+        }
+    } else {
+        memcpy(dst, analysis.amplitudeRecorded.data() + offset, m_samplesPerFrame*sizeof(float));
+    }
+}
+
+void GGWave::recordedAdd(int offset, float * dst) const {
+    const auto & analysis = m_rx.analysis;
+
+    if (m_rxRecordI16) {
+        const int16_t * src = analysis.amplitudeRecordedI16.data() + offset;
+        for (int i = 0; i < m_samplesPerFrame; ++i) {
+            dst[i] += src[i]*(1.0f/32768.0f);
+        }
+    } else {
+        const float * src = analysis.amplitudeRecorded.data() + offset;
+        for (int i = 0; i < m_samplesPerFrame; ++i) {
+            dst[i] += src[i];
+        }
+    }
+}
+
+bool GGWave::energyGateOpen() {
+    const int n = m_samplesPerFrame/kEnergyGateWindowFraction;
+    const float * x = m_rx.amplitudeAverage.data() + m_samplesPerFrame - n;
+
+    int   nBands = 0;
+    int   bandProtocolId[GGWAVE_PROTOCOL_COUNT];
+    float coeff[GGWAVE_PROTOCOL_COUNT];
+    float s1[GGWAVE_PROTOCOL_COUNT];
+    float s2[GGWAVE_PROTOCOL_COUNT];
+
+    for (int i = 0; i < m_rx.protocols.size(); ++i) {
+        const auto & protocol = m_rx.protocols[i];
+        if (protocol.enabled == false) {
+            continue;
+        }
+
+        // protocols with the same start frequency share the marker band
+        bool isMeasured = false;
+        for (int j = 0; j < i; ++j) {
+            if (m_rx.protocols[j].enabled && m_rx.protocols[j].freqStart == protocol.freqStart) {
+                isMeasured = true;
+                break;
+            }
+        }
+        if (isMeasured) {
+            continue;
+        }
+
+        // the window is shorter than a frame, so the filter covers the first few marker bits
+        const double freq = bitFreq(protocol, 0) + 0.5*m_freqDelta_bin*m_hzPerSample;
+
+        bandProtocolId[nBands] = i;
+        coeff[nBands] = 2.0*cos(2.0*M_PI*freq/m_sampleRate);
+        s1[nBands] = 0.0f;
+        s2[nBands] = 0.0f;
+        ++nBands;
+    }
+
+    // Goertzel filters of all bands - the bands are independent, so they are interleaved
+    for (int k = 0; k < n; ++k) {
+        for (int j = 0; j < nBands; ++j) {
+            const float s0 = (x[k] - s2[j]) + coeff[j]*s1[j];
+            s2[j] = s1[j];
+            s1[j] = s0;
+        }
+    }
+
+    bool isOpen = false;
+
+    for (int j = 0; j < nBands; ++j) {
+        const float energy = s1[j]*s1[j] + s2[j]*s2[j] - coeff[j]*s1[j]*s2[j];
+
+        float & floor    = m_rx.energyGateFloor[bandProtocolId[j]];
+        int   & measured = m_rx.energyGateMeasured[bandProtocolId[j]];
+
+        // keep the gate open until the noise floor estimate settles
+        if (measured < kEnergyGateWarmup || energy > kEnergyGateThreshold*floor) {
+            isOpen = true;
+        }
+
+        // plain average for the first measurements, then an exponential moving average
+        ++measured;
+        floor += GG_MAX(kEnergyGateFloorRate, 1.0f/measured)*(energy - floor);
+    }
+
+    return isOpen;
+}
+
+const int * GGWave::markerBins(int protocolId) {
+    const auto & protocol = m_rx.protocols[protocolId];
+
+    int * bins = m_rx.markerBins.data() + protocolId*m_nBitsInMarker;
+
+    if (m_rx.markerBinsFreqStart[protocolId] != protocol.freqStart) {
+        for (int i = 0; i < m_nBitsInMarker; ++i) {
+            bins[i] = round(bitFreq(protocol, i)*m_ihzPerSample);
+        }
+        m_rx.markerBinsFreqStart[protocolId] = protocol.freqStart;
+    }
+
+    return bins;
+}
+
+void GGWave::spectrumBand(int & bin0, int & bin1) {
+    bin0 = minFreqStart(m_rx.protocols);
+    bin1 = maxFreqEnd(m_rx.protocols);
+
+    // the enabled protocols have changed - clear the bins that are no longer updated
+    if (bin0 != m_rx.spectrumBin0 || bin1 != m_rx.spectrumBin1) {
+        m_rx.spectrum.zero();
+
+        m_rx.spectrumBin0 = bin0;
+        m_rx.spectrumBin1 = bin1;
+    }
+}
@@ -0,0 +1,452 @@
+#pragma once
+
+/*
+
+Vectorized kernels for the Tx waveform synthesis and the Rx power spectrum
+
+Each kernel has a scalar reference implementation. The vectorized variants perform exactly the same floating-point
+operations in the same order for every sample, so the results are bit-identical to the scalar ones.
+
+    x86     : SSE2 and AVX2 - AVX2 is selected at runtime if the CPU supports it
+    ARM     : NEON
+    other   : scalar
+
+Define GGWAVE_DISABLE_SIMD to always use the scalar kernels.
+
+*/
+
+#include <stdint.h>
+
+#if !defined(GGWAVE_DISABLE_SIMD)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define GGWAVE_SIMD_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GGWAVE_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+namespace simd {
+
+struct Kernels {
+    const char * name;
+
+    // dst[i] += (scalar*src[i])*env[i]
+    void (*accumulate)(float * dst, const float * src, float scalar, const float * env, int n);
+
+    // dst[i] += src[i]
+    void (*add)(float * dst, const float * src, int n);
+
+    // dst[i] *= scalar
+    void (*scale)(float * dst, float scalar, int n);
+
+    // dst[i] = src[2*i]*src[2*i] + src[2*i + 1]*src[2*i + 1]
+    void (*power)(const float * src, float * dst, int n);
+
+    // convert from 32-bit float
+    void (*convertU8) (const float * src, uint8_t  * dst, int n);
+    void (*convertI8) (const float * src, int8_t   * dst, int n);
+    void (*convertU16)(const float * src, uint16_t * dst, int n);
+    void (*convertI16)(const float * src, int16_t  * dst, int n);
+};
+
+//
+// scalar
+//
+
+inline void accumulate_scalar(float * dst, const float * src, float scalar, const float * env, int n) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] += scalar*src[i]*env[i];
+    }
+}
+
+inline void add_scalar(float * dst, const float * src, int n) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] += src[i];
+    }
+}
+
+inline void scale_scalar(float * dst, float scalar, int n) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] *= scalar;
+    }
+}
+
+inline void power_scalar(const float * src, float * dst, int n) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] = src[2*i + 0]*src[2*i + 0] + src[2*i + 1]*src[2*i + 1];
+    }
+}
+
+// truncate and saturate, like the vectorized conversions do
+inline int32_t saturate_scalar(float x, int32_t lo, int32_t hi) {
+    const int32_t v = (int32_t) x;
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+inline void convertU8_scalar(const float * src, uint8_t * dst, int n) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] = saturate_scalar(128*(src[i] + 1.0f), 0, 255);
+    }
+}
+
+inline void convertI8_scalar(const float * src, int8_t * dst, int n) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] = saturate_scalar(128*src[i], -128, 127);
+    }
+}
+
+inline void convertU16_scalar(const float * src, uint16_t * dst, int n) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] = saturate_scalar(32768*(src[i] + 1.0f), 0, 65535);
+    }
+}
+
+inline void convertI16_scalar(const float * src, int16_t * dst, int n) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] = saturate_scalar(32768*src[i], -32768, 32767);
+    }
+}
+
+#if defined(GGWAVE_SIMD_X86)
+
+//
+// SSE2
+//
+
+inline void accumulate_sse2(float * dst, const float * src, float scalar, const float * env, int n) {
+    const __m128 s = _mm_set1_ps(scalar);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 v = _mm_mul_ps(_mm_mul_ps(s, _mm_loadu_ps(src + i)), _mm_loadu_ps(env + i));
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), v));
+    }
+
+    accumulate_scalar(dst + i, src + i, scalar, env + i, n - i);
+}
+
+inline void add_sse2(float * dst, const float * src, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+    }
+
+    add_scalar(dst + i, src + i, n - i);
+}
+
+inline void scale_sse2(float * dst, float scalar, int n) {
+    const __m128 s = _mm_set1_ps(scalar);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), s));
+    }
+
+    scale_scalar(dst + i, scalar, n - i);
+}
+
+inline void power_sse2(const float * src, float * dst, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 a = _mm_loadu_ps(src + 2*i + 0);
+        const __m128 b = _mm_loadu_ps(src + 2*i + 4);
+        const __m128 a2 = _mm_mul_ps(a, a);
+        const __m128 b2 = _mm_mul_ps(b, b);
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_shuffle_ps(a2, b2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(3, 1, 3, 1))));
+    }
+
+    power_scalar(src + 2*i, dst + i, n - i);
+}
+
+// truncate 16 floats to 32-bit integers and pack them with signed saturation to 16-bit integers
+inline void pack16_sse2(const float * src, __m128 mul, __m128 add, __m128i & lo, __m128i & hi) {
+    const __m128i a = _mm_cvttps_epi32(_mm_mul_ps(mul, _mm_add_ps(_mm_loadu_ps(src +  0), add)));
+    const __m128i b = _mm_cvttps_epi32(_mm_mul_ps(mul, _mm_add_ps(_mm_loadu_ps(src +  4), add)));
+    const __m128i c = _mm_cvttps_epi32(_mm_mul_ps(mul, _mm_add_ps(_mm_loadu_ps(src +  8), add)));
+    const __m128i d = _mm_cvttps_epi32(_mm_mul_ps(mul, _mm_add_ps(_mm_loadu_ps(src + 12), add)));
+
+    lo = _mm_packs_epi32(a, b);
+    hi = _mm_packs_epi32(c, d);
+}
+
+inline void convertU8_sse2(const float * src, uint8_t * dst, int n) {
+    const __m128 mul = _mm_set1_ps(128.0f);
+    const __m128 add = _mm_set1_ps(1.0f);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i lo, hi;
+        pack16_sse2(src + i, mul, add, lo, hi);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+
+    convertU8_scalar(src + i, dst + i, n - i);
+}
+
+inline void convertI8_sse2(const float * src, int8_t * dst, int n) {
+    const __m128 mul = _mm_set1_ps(128.0f);
+    const __m128 add = _mm_setzero_ps();
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i lo, hi;
+        pack16_sse2(src + i, mul, add, lo, hi);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi16(lo, hi));
+    }
+
+    convertI8_scalar(src + i, dst + i, n - i);
+}
+
+inline void convertU16_sse2(const float * src, uint16_t * dst, int n) {
+    const __m128 mul = _mm_set1_ps(32768.0f);
+    const __m128 add = _mm_set1_ps(1.0f);
+    const __m128i bias = _mm_set1_epi32(32768);
+    const __m128i flip = _mm_set1_epi16((int16_t) 0x8000);
+
+    // there is no unsigned 32-bit to 16-bit pack in SSE2, so the values are shifted to the signed range and back
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i a = _mm_sub_epi32(_mm_cvttps_epi32(_mm_mul_ps(mul, _mm_add_ps(_mm_loadu_ps(src + i + 0), add))), bias);
+        const __m128i b = _mm_sub_epi32(_mm_cvttps_epi32(_mm_mul_ps(mul, _mm_add_ps(_mm_loadu_ps(src + i + 4), add))), bias);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(_mm_packs_epi32(a, b), flip));
+    }
+
+    convertU16_scalar(src + i, dst + i, n - i);
+}
+
+inline void convertI16_sse2(const float * src, int16_t * dst, int n) {
+    const __m128 mul = _mm_set1_ps(32768.0f);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i a = _mm_cvttps_epi32(_mm_mul_ps(mul, _mm_loadu_ps(src + i + 0)));
+        const __m128i b = _mm_cvttps_epi32(_mm_mul_ps(mul, _mm_loadu_ps(src + i + 4)));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(a, b));
+    }
+
+    convertI16_scalar(src + i, dst + i, n - i);
+}
+
+//
+// AVX2
+//
+// the format conversions are memory bound and the SSE2 variants are used for them
+//
+
+__attribute__((target("avx2")))
+inline void accumulate_avx2(float * dst, const float * src, float scalar, const float * env, int n) {
+    const __m256 s = _mm256_set1_ps(scalar);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 v = _mm256_mul_ps(_mm256_mul_ps(s, _mm256_loadu_ps(src + i)), _mm256_loadu_ps(env + i));
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), v));
+    }
+
+    accumulate_scalar(dst + i, src + i, scalar, env + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline void add_avx2(float * dst, const float * src, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+    }
+
+    add_scalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline void scale_avx2(float * dst, float scalar, int n) {
+    const __m256 s = _mm256_set1_ps(scalar);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), s));
+    }
+
+    scale_scalar(dst + i, scalar, n - i);
+}
+
+__attribute__((target("avx2")))
+inline void power_avx2(const float * src, float * dst, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 a = _mm256_loadu_ps(src + 2*i + 0);
+        const __m256 b = _mm256_loadu_ps(src + 2*i + 8);
+
+        // the pairs are added within the 128-bit lanes - [0 1 4 5 2 3 6 7] -> [0 1 2 3 4 5 6 7]
+        const __m256 p = _mm256_hadd_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b));
+        _mm256_storeu_ps(dst + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(p), _MM_SHUFFLE(3, 1, 2, 0))));
+    }
+
+    power_sse2(src + 2*i, dst + i, n - i);
+}
+
+#elif defined(GGWAVE_SIMD_NEON)
+
+//
+// NEON
+//
+
+inline void accumulate_neon(float * dst, const float * src, float scalar, const float * env, int n) {
+    const float32x4_t s = vdupq_n_f32(scalar);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const float32x4_t v = vmulq_f32(vmulq_f32(s, vld1q_f32(src + i)), vld1q_f32(env + i));
+        vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), v));
+    }
+
+    accumulate_scalar(dst + i, src + i, scalar, env + i, n - i);
+}
+
+inline void add_neon(float * dst, const float * src, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+    }
+
+    add_scalar(dst + i, src + i, n - i);
+}
+
+inline void scale_neon(float * dst, float scalar, int n) {
+    const float32x4_t s = vdupq_n_f32(scalar);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(dst + i, vmulq_f32(vld1q_f32(dst + i), s));
+    }
+
+    scale_scalar(dst + i, scalar, n - i);
+}
+
+inline void power_neon(const float * src, float * dst, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const float32x4x2_t x = vld2q_f32(src + 2*i);
+        vst1q_f32(dst + i, vaddq_f32(vmulq_f32(x.val[0], x.val[0]), vmulq_f32(x.val[1], x.val[1])));
+    }
+
+    power_scalar(src + 2*i, dst + i, n - i);
+}
+
+// truncate 8 floats to 32-bit integers and narrow them with signed saturation to 16-bit integers
+inline int16x8_t pack8_neon(const float * src, float32x4_t mul, float32x4_t add) {
+    const int32x4_t a = vcvtq_s32_f32(vmulq_f32(mul, vaddq_f32(vld1q_f32(src + 0), add)));
+    const int32x4_t b = vcvtq_s32_f32(vmulq_f32(mul, vaddq_f32(vld1q_f32(src + 4), add)));
+
+    return vcombine_s16(vqmovn_s32(a), vqmovn_s32(b));
+}
+
+inline void convertU8_neon(const float * src, uint8_t * dst, int n) {
+    const float32x4_t mul = vdupq_n_f32(128.0f);
+    const float32x4_t add = vdupq_n_f32(1.0f);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        vst1_u8(dst + i, vqmovun_s16(pack8_neon(src + i, mul, add)));
+    }
+
+    convertU8_scalar(src + i, dst + i, n - i);
+}
+
+inline void convertI8_neon(const float * src, int8_t * dst, int n) {
+    const float32x4_t mul = vdupq_n_f32(128.0f);
+    const float32x4_t add = vdupq_n_f32(0.0f);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        vst1_s8(dst + i, vqmovn_s16(pack8_neon(src + i, mul, add)));
+    }
+
+    convertI8_scalar(src + i, dst + i, n - i);
+}
+
+inline void convertU16_neon(const float * src, uint16_t * dst, int n) {
+    const float32x4_t mul = vdupq_n_f32(32768.0f);
+    const float32x4_t add = vdupq_n_f32(1.0f);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const int32x4_t a = vcvtq_s32_f32(vmulq_f32(mul, vaddq_f32(vld1q_f32(src + i + 0), add)));
+        const int32x4_t b = vcvtq_s32_f32(vmulq_f32(mul, vaddq_f32(vld1q_f32(src + i + 4), add)));
+        vst1q_u16(dst + i, vcombine_u16(vqmovun_s32(a), vqmovun_s32(b)));
+    }
+
+    convertU16_scalar(src + i, dst + i, n - i);
+}
+
+inline void convertI16_neon(const float * src, int16_t * dst, int n) {
+    const float32x4_t mul = vdupq_n_f32(32768.0f);
+    const float32x4_t add = vdupq_n_f32(0.0f);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        vst1q_s16(dst + i, pack8_neon(src + i, mul, add));
+    }
+
+    convertI16_scalar(src + i, dst + i, n - i);
+}
+
+#endif
+
+// the kernels are selected once, on first use
+inline const Kernels & kernels() {
+    static const Kernels res = []() {
+        Kernels k = {
+            "scalar",
+            accumulate_scalar,
+            add_scalar,
+            scale_scalar,
+            power_scalar,
+            convertU8_scalar,
+            convertI8_scalar,
+            convertU16_scalar,
+            convertI16_scalar,
+        };
+
+#if defined(GGWAVE_SIMD_X86)
+        k = {
+            "sse2",
+            accumulate_sse2,
+            add_sse2,
+            scale_sse2,
+            power_sse2,
+            convertU8_sse2,
+            convertI8_sse2,
+            convertU16_sse2,
+            convertI16_sse2,
+        };
+
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            k.name       = "avx2";
+            k.accumulate = accumulate_avx2;
+            k.add        = add_avx2;
+            k.scale      = scale_avx2;
+            k.power      = power_avx2;
+        }
+#elif defined(GGWAVE_SIMD_NEON)
+        k = {
+            "neon",
+            accumulate_neon,
+            add_neon,
+            scale_neon,
+            power_neon,
+            convertU8_neon,
+            convertI8_neon,
+            convertU16_neon,
+            convertI16_neon,
+        };
+#endif
+
+        return k;
+    }();
+
+    return res;
+}
+
+}
@@ -71,6 +71,26 @@ int main() {
     decoded[ret] = 0; // null-terminate the received data
     CHECK(strcmp(decoded, payload) == 0);
 
+    // single-pass encode into a caller-provided buffer
+    {
+        // not enough output buffer size - returns the required size
+        ret = ggwave_nencode(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50, NULL, 0);
+        CHECK(ret == n);
+
+        ret = ggwave_nencode(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50, waveform, n - 1);
+        CHECK(ret == n);
+
+        // just enough size to store it
+        char *waveformN = malloc(n);
+        CHECK(waveformN != NULL);
+
+        ret = ggwave_nencode(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50, waveformN, n);
+        CHECK(ret == ne);
+        CHECK(memcmp(waveform, waveformN, ne) == 0);
+
+        free(waveformN);
+    }
+
     ggwave_free(instance);
     free(waveform);
 
@@ -1,5 +1,8 @@
 #include "ggwave/ggwave.h"
 
+#include "../src/simd.h"
+
+#include <cmath>
 #include <cstring>
 #include <limits>
 #include <string>
@@ -9,6 +12,9 @@
 #include <set>
 #include <cstdint>
 #include <map>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 constexpr float iRandMax = 1.0f/float(RAND_MAX);
 float frand() { return float(rand()%RAND_MAX)*iRandMax; }
@@ -200,6 +206,139 @@ int main(int argc, char ** argv) {
         CHECK_F(instance.init(payload.size(), payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 101));
     }
 
+    // tone tables - cached and shared tables must produce the same waveform as freshly computed ones
+    {
+        const std::string payload = "tables";
+
+        auto encodeHelper = [&](GGWave & instance, GGWave::TxProtocolId protocolId) {
+            CHECK(instance.init(payload.c_str(), protocolId, 25));
+            const auto nBytes = instance.encode();
+            CHECK(nBytes > 0);
+            auto p = (const uint8_t *)(instance.txWaveform());
+            return std::vector<uint8_t>(p, p + nBytes);
+        };
+
+        GGWave instanceShared(GGWave::getDefaultParameters());
+        GGWave instanceCached(GGWave::getDefaultParameters());
+        CHECK(instanceCached.txShareToneTables(instanceShared));
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.samplesPerFrame = 512;
+        GGWave instanceOther(parameters);
+        CHECK_F(instanceOther.txShareToneTables(instanceShared));
+
+        for (auto protocolId : { GGWAVE_PROTOCOL_AUDIBLE_FAST, GGWAVE_PROTOCOL_ULTRASOUND_FAST, GGWAVE_PROTOCOL_AUDIBLE_FAST, GGWAVE_PROTOCOL_DT_FAST }) {
+            GGWave instance(GGWave::getDefaultParameters());
+            const auto expected = encodeHelper(instance, protocolId);
+
+            CHECK(encodeHelper(instanceCached, protocolId) == expected);
+            CHECK(encodeHelper(instanceShared, protocolId) == expected);
+        }
+    }
+
+    // symbol cache - the waveform must be identical to the one synthesized without the cache
+    for (int payloadLength : { -1, 4 }) {
+        const std::string payload = "cache";
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.payloadLength = payloadLength;
+
+        GGWave instance(parameters);
+
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_TX_SYMBOL_CACHE;
+        GGWave instanceCached(parameters);
+
+        for (int protocolId = 0; protocolId < GGWAVE_PROTOCOL_COUNT; ++protocolId) {
+            const auto & protocol = GGWave::Protocols::kDefault()[protocolId];
+            if (protocol.enabled == false) continue;
+            if (protocol.extra == 2 && payloadLength < 0) continue;
+
+            for (int volume : { 25, 25, 50 }) {
+                CHECK(instance.init(payload.c_str(), GGWave::ProtocolId(protocolId), volume));
+                const auto nBytes = instance.encode();
+                auto p = (const uint8_t *)(instance.txWaveform());
+                const std::vector<uint8_t> expected(p, p + nBytes);
+
+                CHECK(instanceCached.init(payload.c_str(), GGWave::ProtocolId(protocolId), volume));
+                CHECK(instanceCached.encode() == nBytes);
+                p = (const uint8_t *)(instanceCached.txWaveform());
+                CHECK(std::vector<uint8_t>(p, p + nBytes) == expected);
+            }
+        }
+    }
+
+    // oscillator synthesis - the waveform must match the sine tables up to rounding and must be decodable
+    {
+        const std::string payload = "oscillator";
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+
+        GGWave instance(parameters);
+
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_TX_NCO;
+        GGWave instanceNCO(parameters);
+        CHECK(instanceNCO.heapSize() < instance.heapSize());
+
+        for (auto protocolId : { GGWAVE_PROTOCOL_AUDIBLE_FASTEST, GGWAVE_PROTOCOL_ULTRASOUND_FASTEST, GGWAVE_PROTOCOL_DT_FASTEST }) {
+            CHECK(instance.init(payload.c_str(), protocolId, 25));
+            const auto nBytes = instance.encode();
+            const auto expected = (const float *)(instance.txWaveform());
+
+            CHECK(instanceNCO.init(payload.c_str(), protocolId, 25));
+            CHECK(instanceNCO.encode() == nBytes);
+            const auto result = (const float *)(instanceNCO.txWaveform());
+
+            for (int i = 0; i < (int) (nBytes/sizeof(float)); ++i) {
+                CHECK(std::fabs(expected[i] - result[i]) < 1e-6f);
+            }
+
+            buffer.resize(nBytes);
+            memcpy(buffer.data(), result, nBytes);
+            instanceNCO.decode(buffer.data(), buffer.size());
+
+            GGWave::TxRxData data;
+            CHECK(instanceNCO.rxTakeData(data) == (int) payload.size());
+            CHECK(memcmp(data.data(), payload.data(), payload.size()) == 0);
+        }
+    }
+
+    // streaming encode - the incremental waveform must match the one produced by encode()
+    for (const auto & format : kFormats) {
+        for (float sampleRateOut : { GGWave::kDefaultSampleRate, 44100.0f }) {
+            const std::string payload = "stream";
+
+            auto parameters = GGWave::getDefaultParameters();
+            parameters.sampleFormatOut = format;
+            parameters.sampleRateOut = sampleRateOut;
+
+            GGWave instance(parameters);
+            CHECK(instance.init(payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 25));
+            const auto nBytes = instance.encode();
+            auto p = (const uint8_t *)(instance.txWaveform());
+            const std::vector<uint8_t> expected(p, p + nBytes);
+
+            parameters.operatingMode |= GGWAVE_OPERATING_MODE_TX_STREAMING;
+            GGWave instanceStreaming(parameters);
+            CHECK(instanceStreaming.heapSize() < instance.heapSize());
+            CHECK(instanceStreaming.init(payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 25));
+            CHECK(instanceStreaming.encode() == 0);
+
+            const int sampleSize = instanceStreaming.sampleSizeOut();
+
+            CHECK(instanceStreaming.encodeBegin());
+            std::vector<uint8_t> result;
+            std::vector<uint8_t> chunk(1000*sampleSize);
+            int n = 0;
+            for (int i = 0; (n = instanceStreaming.encodeFrames(chunk.data(), 1 + (137*i)%1000)) > 0; ++i) {
+                result.insert(result.end(), chunk.begin(), chunk.begin() + n*sampleSize);
+            }
+            CHECK(n == 0);
+            CHECK(result == expected);
+        }
+    }
+
     // playback / capture at different sample rates
     for (int srInp = GGWave::kDefaultSampleRate/6; srInp <= 2*GGWave::kDefaultSampleRate; srInp += 1371) {
         printf("Testing: sample rate = %d\n", srInp);
@@ -218,7 +357,7 @@ int main(int argc, char ** argv) {
             const auto expectedSize = instanceOut.encodeSize_bytes();
             const auto nBytes = instanceOut.encode();
             printf("Expected = %d, actual = %d\n", expectedSize, nBytes);
-            CHECK(expectedSize >= nBytes);
+            CHECK(expectedSize == nBytes);
             { auto p = (const uint8_t *)(instanceOut.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
             addNoiseHelper(0.01, parameters.sampleFormatOut); // add some artificial noise
             convertHelper(parameters.sampleFormatOut, parameters.sampleFormatInp);
@@ -240,6 +379,931 @@ int main(int argc, char ** argv) {
         }
     }
 
+    // resampler types and qualities
+    for (int quality = 0; quality <= GGWave::Resampler::kMaxQuality; ++quality) {
+        for (int srInp : { 44100, 22050, 16000, 96000, 44123, 7919 }) {
+            printf("Testing: resampler quality = %d, sample rate = %d\n", quality, srInp);
+
+            auto parameters = GGWave::getDefaultParameters();
+            parameters.resamplerType    = quality == 0 ? GGWAVE_RESAMPLER_SINC : GGWAVE_RESAMPLER_POLYPHASE;
+            parameters.resamplerQuality = quality;
+            parameters.sampleRateOut    = srInp;
+            parameters.sampleRateInp    = srInp;
+
+            const std::string payload = "resample";
+
+            GGWave instance(parameters);
+            instance.rxProtocols().only(GGWAVE_PROTOCOL_DT_FASTEST);
+
+            instance.init(payload.c_str(), GGWAVE_PROTOCOL_DT_FASTEST, 25);
+            const auto expectedSize = instance.encodeSize_bytes();
+            const auto nBytes = instance.encode();
+            CHECK(expectedSize == nBytes);
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
+
+            instance.decode(buffer.data(), buffer.size());
+
+            GGWave::TxRxData result;
+            CHECK(instance.rxTakeData(result) == (int) payload.size());
+            for (int i = 0; i < (int) payload.size(); ++i) {
+                CHECK(payload[i] == result[i]);
+            }
+        }
+    }
+
+    // full duplex - decoding while transmitting must not affect either direction
+    {
+        const std::string payloadTx = "duplex-tx";
+        const std::string payloadRx = "duplex-rx";
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleRateInp = 44100;
+        parameters.sampleRateOut = 22050;
+
+        // the waveform that is being received
+        {
+            auto parametersOut = parameters;
+            parametersOut.sampleRateOut = parameters.sampleRateInp;
+            GGWave instanceOut(parametersOut);
+            CHECK(instanceOut.init(payloadRx.c_str(), GGWAVE_PROTOCOL_DT_FASTEST, 25));
+            const auto nBytes = instanceOut.encode();
+            { auto p = (const uint8_t *)(instanceOut.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
+        }
+
+        GGWave instanceRef(parameters);
+        CHECK(instanceRef.init(payloadTx.c_str(), GGWAVE_PROTOCOL_DT_FASTEST, 25));
+        const auto nBytesRef = instanceRef.encode();
+        auto p = (const uint8_t *)(instanceRef.txWaveform());
+        const std::vector<uint8_t> expected(p, p + nBytesRef);
+
+        GGWave instance(parameters);
+        instance.rxProtocols().only(GGWAVE_PROTOCOL_DT_FASTEST);
+
+        const int sampleSizeInp = instance.sampleSizeInp();
+        const int sampleSizeOut = instance.sampleSizeOut();
+        const int nChunk = 777;
+
+        std::vector<uint8_t> result;
+        std::vector<uint8_t> chunk(nChunk*sampleSizeOut);
+
+        CHECK(instance.init(payloadTx.c_str(), GGWAVE_PROTOCOL_DT_FASTEST, 25));
+        CHECK(instance.encodeBegin());
+
+        // interleave the capture and the playback, one chunk at a time
+        int n = 0;
+        for (int offset = 0; offset < (int) buffer.size(); offset += nChunk*sampleSizeInp) {
+            CHECK(instance.decode(buffer.data() + offset, std::min(nChunk*sampleSizeInp, (int) buffer.size() - offset)));
+            if ((n = instance.encodeFrames(chunk.data(), nChunk)) > 0) {
+                result.insert(result.end(), chunk.begin(), chunk.begin() + n*sampleSizeOut);
+            }
+        }
+        while ((n = instance.encodeFrames(chunk.data(), nChunk)) > 0) {
+            result.insert(result.end(), chunk.begin(), chunk.begin() + n*sampleSizeOut);
+        }
+        CHECK(result == expected);
+
+        GGWave::TxRxData data;
+        CHECK(instance.rxTakeData(data) == (int) payloadRx.size());
+        for (int i = 0; i < (int) payloadRx.size(); ++i) {
+            CHECK(payloadRx[i] == data[i]);
+        }
+    }
+
+    // analysis - the start offset should be found from the start marker without scanning all offsets
+    for (auto protocolId : { GGWAVE_PROTOCOL_AUDIBLE_NORMAL, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, GGWAVE_PROTOCOL_ULTRASOUND_FAST, GGWAVE_PROTOCOL_DT_NORMAL }) {
+        for (int nSilence : { 0, 1000, 12345 }) {
+            const std::string payload = "offset";
+
+            GGWave instance(GGWave::getDefaultParameters());
+            instance.rxProtocols().only(protocolId);
+
+            CHECK(instance.init(payload.c_str(), protocolId, 25));
+            const auto nBytes = instance.encode();
+
+            const int sampleSize = instance.sampleSizeOut();
+            buffer.assign(nSilence*sampleSize, 0);
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.insert(buffer.end(), p, p + nBytes); }
+            addNoiseHelper(0.01, instance.sampleFormatOut());
+
+            instance.decode(buffer.data(), buffer.size());
+
+            GGWave::TxRxData result;
+            CHECK(instance.rxTakeData(result) == (int) payload.size());
+            for (int i = 0; i < (int) payload.size(); ++i) {
+                CHECK(payload[i] == result[i]);
+            }
+
+            const auto & stats = instance.rxAnalysisStats();
+            CHECK(stats.nAnalyses == 1);
+            CHECK(stats.nFallbacks == 0);
+            CHECK(stats.nCandidatesLast >= 1 && stats.nCandidatesLast <= GGWave::kAnalysisCandidates);
+            CHECK(stats.nCandidates == stats.nCandidatesLast);
+        }
+    }
+
+    // analysis cache - the exhaustive offset search must give the same result with fewer FFTs
+    //   case 0: the end of the start marker is silenced, so the offset is found only by the exhaustive search
+    //   case 1: the data is silenced, so all offsets are tried without success
+    for (int iCase = 0; iCase < 2; ++iCase) {
+        const std::string payload = "fallback";
+
+        int nFFTs[2] = { 0, 0 };
+        for (int useCache = 0; useCache < 2; ++useCache) {
+            auto parameters = GGWave::getDefaultParameters();
+            if (useCache) parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_ANALYSIS_CACHE;
+
+            GGWave instance(parameters);
+            instance.rxProtocols().only(GGWAVE_PROTOCOL_AUDIBLE_FAST);
+
+            CHECK(instance.init(payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25));
+            const auto nBytes = instance.encode();
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.assign(p, p + nBytes); }
+
+            const int frameSize = instance.samplesPerFrame()*instance.sampleSizeOut();
+            const int nMarkerBytes = GGWave::kDefaultMarkerFrames*frameSize;
+            if (iCase == 0) {
+                std::fill(buffer.begin() + nMarkerBytes - 4*frameSize, buffer.begin() + nMarkerBytes, 0);
+            } else {
+                std::fill(buffer.begin() + nMarkerBytes, buffer.end() - nMarkerBytes, 0);
+            }
+
+            instance.decode(buffer.data(), buffer.size());
+
+            GGWave::TxRxData result;
+            if (iCase == 0) {
+                CHECK(instance.rxTakeData(result) == (int) payload.size());
+                for (int i = 0; i < (int) payload.size(); ++i) {
+                    CHECK(payload[i] == result[i]);
+                }
+            } else {
+                CHECK(instance.rxTakeData(result) == -1);
+            }
+
+            const auto & stats = instance.rxAnalysisStats();
+            CHECK(stats.nFallbacks == 1);
+            CHECK(stats.nCandidatesLast > GGWave::kAnalysisCandidates);
+
+            nFFTs[useCache] = stats.nFFTs;
+        }
+
+        printf("Analysis FFTs: %d without cache, %d with cache\n", nFFTs[0], nFFTs[1]);
+        if (iCase == 1) {
+            CHECK(nFFTs[1] < nFFTs[0]);
+        }
+    }
+
+    // analysis budget - the analysis is spread across decode() calls and does the same work as without a budget
+    for (int useCache = 0; useCache < 2; ++useCache) {
+        const std::string payload = "budget";
+        const auto protocolId = GGWAVE_PROTOCOL_AUDIBLE_FAST;
+
+        int nFFTs[2] = { 0, 0 };
+        for (int analysisBudget : { 0, 4 }) {
+            auto parameters = GGWave::getDefaultParameters();
+            if (useCache) parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_ANALYSIS_CACHE;
+            parameters.analysisBudget = analysisBudget;
+
+            GGWave instance(parameters);
+            instance.rxProtocols().only(protocolId);
+
+            CHECK(instance.init(payload.c_str(), protocolId, 25));
+            const auto nBytes = instance.encode();
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.assign(p, p + nBytes); }
+
+            // force the exhaustive search by silencing the end of the start marker
+            const int frameSize = instance.samplesPerFrame()*instance.sampleSizeOut();
+            const int nMarkerBytes = GGWave::kDefaultMarkerFrames*frameSize;
+            std::fill(buffer.begin() + nMarkerBytes - 4*frameSize, buffer.begin() + nMarkerBytes, 0);
+            buffer.resize(buffer.size() + 4*frameSize, 0);
+
+            int nCalls = 0;
+            int nFFTsLast = 0;
+            int framesLeftLast = 0;
+            for (int offset = 0; offset < (int) buffer.size() || instance.rxAnalyzing(); offset += frameSize) {
+                if (offset < (int) buffer.size()) {
+                    instance.decode(buffer.data() + offset, frameSize);
+                } else {
+                    instance.decode(nullptr, 0);
+                }
+
+                const auto & stats = instance.rxAnalysisStats();
+                if (analysisBudget > 0) {
+                    CHECK(stats.nFFTs - nFFTsLast <= analysisBudget + (useCache ? GGWave::Protocols::rx()[protocolId].framesPerTx : 0));
+                }
+                nFFTsLast = stats.nFFTs;
+
+                if (instance.rxAnalyzing()) {
+                    CHECK(instance.rxFramesToAnalyze() > 0);
+                    CHECK(instance.rxFramesLeftToAnalyze() > 0 && instance.rxFramesLeftToAnalyze() <= instance.rxFramesToAnalyze());
+                    if (nCalls > 0) {
+                        CHECK(instance.rxFramesLeftToAnalyze() <= framesLeftLast);
+                    }
+                    framesLeftLast = instance.rxFramesLeftToAnalyze();
+                    ++nCalls;
+                }
+            }
+
+            GGWave::TxRxData result;
+            CHECK(instance.rxTakeData(result) == (int) payload.size());
+            for (int i = 0; i < (int) payload.size(); ++i) {
+                CHECK(payload[i] == result[i]);
+            }
+
+            const auto & stats = instance.rxAnalysisStats();
+            CHECK(stats.nAnalyses == 1);
+            CHECK(stats.nFallbacks == 1);
+            CHECK(analysisBudget > 0 ? nCalls > 1 : nCalls == 0);
+
+            printf("Analysis budget %d: %d FFTs in %d decode() calls\n", analysisBudget, stats.nFFTs, nCalls);
+
+            nFFTs[analysisBudget > 0] = stats.nFFTs;
+        }
+
+        CHECK(nFFTs[0] == nFFTs[1]);
+    }
+
+    // recording - 16-bit storage, including the exhaustive offset search
+    for (int useCache = 0; useCache < 2; ++useCache) {
+        const std::string payload = "recorded";
+
+        auto parameters = GGWave::getDefaultParameters();
+        if (useCache) parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_ANALYSIS_CACHE;
+
+        GGWave instance(parameters);
+
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_RECORD_I16;
+        GGWave instanceI16(parameters);
+
+        CHECK(instanceI16.heapSize() < instance.heapSize());
+
+        CHECK(instance.init(payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25));
+        const auto nBytes = instance.encode();
+        { auto p = (const uint8_t *)(instance.txWaveform()); buffer.assign(p, p + nBytes); }
+
+        const int frameSize = instance.samplesPerFrame()*instance.sampleSizeOut();
+        const int nMarkerBytes = GGWave::kDefaultMarkerFrames*frameSize;
+        std::fill(buffer.begin() + nMarkerBytes - 4*frameSize, buffer.begin() + nMarkerBytes, 0);
+
+        instanceI16.decode(buffer.data(), buffer.size());
+
+        GGWave::TxRxData result;
+        CHECK(instanceI16.rxTakeData(result) == (int) payload.size());
+        for (int i = 0; i < (int) payload.size(); ++i) {
+            CHECK(payload[i] == result[i]);
+        }
+        CHECK(instanceI16.rxAnalysisStats().nFallbacks == 1);
+    }
+
+    // recording - the buffer fits the Rx protocols enabled at construction
+    {
+        const std::string payload = "sized";
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.operatingMode = GGWAVE_OPERATING_MODE_RX;
+
+        GGWave instance(parameters);
+
+        auto protocolsRx = GGWave::Protocols::rx();
+        GGWave::Protocols::rx().only(GGWAVE_PROTOCOL_AUDIBLE_FASTEST);
+        GGWave instanceFastest(parameters);
+        GGWave::Protocols::rx() = protocolsRx;
+
+        CHECK(2*instanceFastest.heapSize() < instance.heapSize());
+
+        // a protocol enabled after construction can still receive short payloads
+        instanceFastest.rxProtocols().toggle(GGWAVE_PROTOCOL_AUDIBLE_NORMAL, true);
+
+        GGWave instanceTx(GGWave::getDefaultParameters());
+        CHECK(instanceTx.init(payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_NORMAL, 25));
+        const auto nBytes = instanceTx.encode();
+        { auto p = (const uint8_t *)(instanceTx.txWaveform()); buffer.assign(p, p + nBytes); }
+
+        instanceFastest.decode(buffer.data(), buffer.size());
+
+        GGWave::TxRxData result;
+        CHECK(instanceFastest.rxTakeData(result) == (int) payload.size());
+        for (int i = 0; i < (int) payload.size(); ++i) {
+            CHECK(payload[i] == result[i]);
+        }
+    }
+
+    // capture in chunks - frames split across decode() calls, with and without resampling, for both recording storages
+    for (int useI16 = 0; useI16 < 2; ++useI16) {
+        for (int srInp : { 48000, 44100 }) {
+            printf("Testing: chunked capture, 16-bit recording = %d, sample rate = %d\n", useI16, srInp);
+
+            const std::string payload = "chunks";
+
+            auto parameters = GGWave::getDefaultParameters();
+            parameters.sampleRateOut = srInp;
+            parameters.sampleRateInp = srInp;
+            if (useI16) parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_RECORD_I16;
+
+            GGWave instance(parameters);
+            instance.rxProtocols().only(GGWAVE_PROTOCOL_AUDIBLE_FAST);
+
+            CHECK(instance.init(payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25));
+            const auto nBytes = instance.encode();
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.assign(p, p + nBytes); }
+
+            const int chunkSize = 333*instance.sampleSizeInp();
+            int nFrames = 0;
+            GGWave::Amplitude amplitude;
+            for (int i = 0; i < (int) buffer.size(); i += chunkSize) {
+                instance.decode(buffer.data() + i, std::min(chunkSize, (int) buffer.size() - i));
+                nFrames += instance.rxTakeAmplitude(amplitude);
+            }
+            CHECK(nFrames > 0);
+
+            GGWave::TxRxData result;
+            CHECK(instance.rxTakeData(result) == (int) payload.size());
+            for (int i = 0; i < (int) payload.size(); ++i) {
+                CHECK(payload[i] == result[i]);
+            }
+        }
+    }
+
+    // energy-gated listening - most spectrum updates are skipped while the marker bands are quiet
+    for (int useGate = 0; useGate < 2; ++useGate) {
+        const std::string payload = "gated";
+
+        auto parameters = GGWave::getDefaultParameters();
+        if (useGate) parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_ENERGY_GATE;
+
+        GGWave instance(parameters);
+
+        CHECK(instance.init(payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25));
+        const auto nBytes = instance.encode();
+
+        const int nQuietBytes = 5*instance.sampleRateOut()*instance.sampleSizeOut();
+        buffer.assign(nQuietBytes, 0);
+        { auto p = (const uint8_t *)(instance.txWaveform()); buffer.insert(buffer.end(), p, p + nBytes); }
+        addNoiseHelper(0.02, GGWAVE_SAMPLE_FORMAT_F32);
+
+        instance.decode(buffer.data(), buffer.size());
+
+        GGWave::TxRxData result;
+        CHECK(instance.rxTakeData(result) == (int) payload.size());
+        for (int i = 0; i < (int) payload.size(); ++i) {
+            CHECK(payload[i] == result[i]);
+        }
+
+        const auto & stats = instance.rxListenStats();
+        CHECK(stats.nFrames > 0);
+        CHECK(stats.nSpectra + stats.nSpectraGated <= stats.nFrames/GGWave::kMaxSpectrumHistory + 1);
+        if (useGate) {
+            CHECK(stats.nSpectraGated > 2*stats.nSpectra);
+        } else {
+            CHECK(stats.nSpectraGated == 0);
+        }
+    }
+
+    // marker detection - checking more often detects the start marker earlier
+    {
+        const std::string payload = "hop";
+
+        int framesDetected[3] = { 0, 0, 0 };
+        int iHop = 0;
+        for (int markerHop : { 1, 2, 4 }) {
+            auto parameters = GGWave::getDefaultParameters();
+            parameters.markerHop = markerHop;
+
+            GGWave instance(parameters);
+
+            CHECK(instance.init(payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 25));
+            const auto nBytes = instance.encode();
+
+            // start the transmission in the middle of the history cycle
+            const int frameSize = instance.samplesPerFrame()*instance.sampleSizeOut();
+            buffer.assign(5*frameSize + frameSize/2, 0);
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.insert(buffer.end(), p, p + nBytes); }
+
+            for (int i = 0; i + frameSize <= (int) buffer.size(); i += frameSize) {
+                instance.decode(buffer.data() + i, frameSize);
+                if (framesDetected[iHop] == 0 && instance.rxReceiving()) {
+                    framesDetected[iHop] = i/frameSize;
+                }
+            }
+
+            GGWave::TxRxData result;
+            CHECK(instance.rxTakeData(result) == (int) payload.size());
+            for (int i = 0; i < (int) payload.size(); ++i) {
+                CHECK(payload[i] == result[i]);
+            }
+
+            ++iHop;
+        }
+
+        CHECK(framesDetected[0] > 0);
+        CHECK(framesDetected[0] <= framesDetected[1]);
+        CHECK(framesDetected[1] <= framesDetected[2]);
+        CHECK(framesDetected[0] < framesDetected[2]);
+    }
+
+    // invalid marker hop
+    {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.markerHop = 3;
+        GGWave instance(parameters);
+        CHECK(instance.heapSize() == 0);
+    }
+
+    // marker detection - changing the start frequency of an Rx protocol after the first reception
+    {
+        const auto protocolId = GGWAVE_PROTOCOL_AUDIBLE_FAST;
+        const int freqStart = GGWave::Protocols::tx()[protocolId].freqStart;
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.operatingMode = GGWAVE_OPERATING_MODE_RX;
+
+        GGWave instance(parameters);
+        instance.rxProtocols().only(protocolId);
+
+        for (int freqStartTx : { freqStart, freqStart + 24 }) {
+            GGWave::Protocols::tx()[protocolId].freqStart = freqStartTx;
+            instance.rxProtocols()[protocolId].freqStart = freqStartTx;
+
+            const std::string payload = "moved";
+
+            GGWave instanceTx(GGWave::getDefaultParameters());
+            CHECK(instanceTx.init(payload.c_str(), protocolId, 25));
+            const auto nBytes = instanceTx.encode();
+            { auto p = (const uint8_t *)(instanceTx.txWaveform()); buffer.assign(p, p + nBytes); }
+
+            instance.decode(buffer.data(), buffer.size());
+
+            GGWave::TxRxData result;
+            CHECK(instance.rxTakeData(result) == (int) payload.size());
+            for (int i = 0; i < (int) payload.size(); ++i) {
+                CHECK(payload[i] == result[i]);
+            }
+        }
+
+        GGWave::Protocols::tx()[protocolId].freqStart = freqStart;
+    }
+
+    // fixed payload length with the default Rx protocols - the empty custom slots are skipped by the tone votes
+    {
+        const std::string payload = "slots";
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.payloadLength = (int) payload.size();
+
+        GGWave instance(parameters);
+        CHECK(instance.rxProtocols()[GGWAVE_PROTOCOL_CUSTOM_0].enabled == false);
+        CHECK(instance.rxProtocols()[GGWAVE_PROTOCOL_CUSTOM_0].bytesPerTx == 0);
+
+        CHECK(instance.init(payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25));
+        const auto nBytes = instance.encode();
+        CHECK(nBytes > 0);
+        instance.decode(instance.txWaveform(), nBytes);
+
+        GGWave::TxRxData result;
+        CHECK(instance.rxTakeData(result) == (int) payload.size());
+        CHECK(memcmp(result.data(), payload.data(), payload.size()) == 0);
+    }
+
+    // fixed payload length - the tone votes follow the changes of the Rx protocols between receptions
+    {
+        const int freqStart = GGWave::Protocols::tx()[GGWAVE_PROTOCOL_AUDIBLE_FAST].freqStart;
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.payloadLength = 6;
+
+        GGWave instance(parameters);
+
+        const std::pair<GGWave::ProtocolId, int> cases[] = {
+            { GGWAVE_PROTOCOL_AUDIBLE_FAST, freqStart      },
+            { GGWAVE_PROTOCOL_MT_FASTEST,   GGWave::Protocols::tx()[GGWAVE_PROTOCOL_MT_FASTEST].freqStart },
+            { GGWAVE_PROTOCOL_AUDIBLE_FAST, freqStart + 24 },
+        };
+
+        for (const auto & c : cases) {
+            const std::string payload = "fixed" + std::to_string(c.second%10);
+
+            const int freqStartOrig = GGWave::Protocols::tx()[c.first].freqStart;
+            GGWave::Protocols::tx()[c.first].freqStart = c.second;
+            instance.rxProtocols().only(c.first);
+            instance.rxProtocols()[c.first].freqStart = c.second;
+
+            GGWave instanceTx(parameters);
+            CHECK(instanceTx.init(payload.c_str(), c.first, 25));
+            const auto nBytes = instanceTx.encode();
+            { auto p = (const uint8_t *)(instanceTx.txWaveform()); buffer.assign(p, p + nBytes); }
+
+            GGWave::Protocols::tx()[c.first].freqStart = freqStartOrig;
+
+            instance.decode(buffer.data(), buffer.size());
+
+            GGWave::TxRxData result;
+            CHECK(instance.rxTakeData(result) == (int) payload.size());
+            for (int i = 0; i < (int) payload.size(); ++i) {
+                CHECK(payload[i] == result[i]);
+            }
+        }
+    }
+
+    // parallel analysis - the workers must find the same candidate as the sequential analysis
+    for (int iCase = 0; iCase < 2; ++iCase) {
+        const std::string payload = "parallel";
+
+        auto executor = [](GGWave * instance, int nWorkers, void * ) {
+            std::vector<std::thread> threads;
+            for (int i = 1; i < nWorkers; ++i) {
+                threads.emplace_back([instance, i]() { instance->rxAnalysisWorker(i); });
+            }
+            instance->rxAnalysisWorker(0);
+            for (auto & thread : threads) {
+                thread.join();
+            }
+        };
+
+        GGWave::ProtocolId protocolIdRef = GGWAVE_PROTOCOL_COUNT;
+        int nFallbacksRef = 0;
+        for (int nWorkers : { 0, 1, 2, 3, 8 }) {
+            auto parameters = GGWave::getDefaultParameters();
+            parameters.analysisWorkers = nWorkers;
+
+            GGWave instance(parameters);
+            if (nWorkers != 3) {
+                instance.rxSetParallelExecutor(executor, nullptr);
+            }
+
+            CHECK(instance.init(payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 25));
+            const auto nBytes = instance.encode();
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.assign(p, p + nBytes); }
+
+            // case 1: the offset is found only by the exhaustive search
+            if (iCase == 1) {
+                const int frameSize = instance.samplesPerFrame()*instance.sampleSizeOut();
+                const int nMarkerBytes = GGWave::kDefaultMarkerFrames*frameSize;
+                std::fill(buffer.begin() + nMarkerBytes - 4*frameSize, buffer.begin() + nMarkerBytes, 0);
+            }
+
+            instance.decode(buffer.data(), buffer.size());
+
+            GGWave::TxRxData result;
+            CHECK(instance.rxTakeData(result) == (int) payload.size());
+            for (int i = 0; i < (int) payload.size(); ++i) {
+                CHECK(payload[i] == result[i]);
+            }
+
+            const auto & stats = instance.rxAnalysisStats();
+            if (nWorkers == 0) {
+                protocolIdRef = instance.rxProtocolId();
+                nFallbacksRef = stats.nFallbacks;
+            }
+
+            CHECK(instance.rxProtocolId() == protocolIdRef);
+            CHECK(stats.nFallbacks == nFallbacksRef);
+        }
+
+        CHECK(nFallbacksRef == iCase);
+    }
+
+    // asynchronous analysis - the next payload is received while the previous one is analyzed on a worker thread
+    {
+        struct Context {
+            std::thread thread;
+            std::atomic<bool> release { false };
+            std::atomic<int> nExecuted { 0 };
+
+            std::mutex mutex;
+            std::vector<std::string> payloads;
+            std::vector<GGWave::ProtocolId> protocolIds;
+        } ctx;
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_ASYNC_ANALYSIS;
+
+        GGWave instance(parameters);
+        instance.rxSetAnalysisExecutor([](GGWave * instance, void * userData) {
+            auto ctx = (Context *) userData;
+            if (ctx->thread.joinable()) {
+                ctx->thread.join();
+            }
+            ctx->nExecuted++;
+            ctx->thread = std::thread([instance, ctx]() {
+                while (ctx->release == false) {
+                    std::this_thread::yield();
+                }
+                CHECK(instance->rxAnalyzeCapture());
+            });
+        }, &ctx);
+        instance.rxSetCallback([](const uint8_t * payload, int length, GGWave::ProtocolId protocolId, void * userData) {
+            auto ctx = (Context *) userData;
+            CHECK(payload != nullptr && length > 0);
+
+            std::lock_guard<std::mutex> lock(ctx->mutex);
+            ctx->payloads.push_back(std::string((const char *) payload, length));
+            ctx->protocolIds.push_back(protocolId);
+        }, &ctx);
+
+        const std::string payloads[2] = { "first", "second" };
+        const GGWave::TxProtocolId protocolIds[2] = { GGWAVE_PROTOCOL_AUDIBLE_FAST, GGWAVE_PROTOCOL_DT_FASTEST };
+
+        const int frameSize = instance.samplesPerFrame()*instance.sampleSizeOut();
+
+        buffer.clear();
+        for (int i = 0; i < 2; ++i) {
+            CHECK(instance.init(payloads[i].c_str(), protocolIds[i], 25));
+            const auto nBytes = instance.encode();
+            auto p = (const uint8_t *)(instance.txWaveform());
+            buffer.insert(buffer.end(), p, p + nBytes);
+            buffer.insert(buffer.end(), 8*frameSize, 0);
+        }
+
+        // the analysis of the first payload is held back until all audio is decoded
+        for (int offset = 0; offset < (int) buffer.size(); offset += frameSize) {
+            instance.decode(buffer.data() + offset, std::min(frameSize, (int) buffer.size() - offset));
+        }
+
+        CHECK(ctx.nExecuted == 1);
+        CHECK(instance.rxAnalysisInFlight());
+
+        ctx.release = true;
+        ctx.thread.join();
+        CHECK(instance.rxAnalysisInFlight() == false);
+
+        // the second capture is handed off by the next decode() call
+        instance.decode(nullptr, 0);
+        CHECK(ctx.nExecuted == 2);
+        ctx.thread.join();
+
+        CHECK(ctx.payloads.size() == 2);
+        for (int i = 0; i < 2; ++i) {
+            CHECK(ctx.payloads[i] == payloads[i]);
+            CHECK(ctx.protocolIds[i] == protocolIds[i]);
+        }
+
+        GGWave::TxRxData result;
+        CHECK(instance.rxTakeData(result) == 0);
+    }
+
+    // asynchronous analysis - decoding and transmitting continue while the executor analyzes the capture
+    {
+        struct Context {
+            std::thread thread;
+            std::atomic<int> nDecoded { 0 };
+            std::atomic<int> nReceived { 0 };
+        } ctx;
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_ASYNC_ANALYSIS;
+
+        GGWave instance(parameters);
+        instance.rxSetAnalysisExecutor([](GGWave * instance, void * userData) {
+            auto ctx = (Context *) userData;
+            if (ctx->thread.joinable()) {
+                ctx->thread.join();
+            }
+            ctx->thread = std::thread([instance, ctx]() {
+                while (ctx->nDecoded == 0) {
+                    std::this_thread::yield();
+                }
+                CHECK(instance->rxAnalyzeCapture());
+            });
+        }, &ctx);
+        instance.rxSetCallback([](const uint8_t * payload, int length, GGWave::ProtocolId , void * userData) {
+            auto ctx = (Context *) userData;
+            CHECK(payload != nullptr && length == 4 && std::memcmp(payload, "ping", 4) == 0);
+            ctx->nReceived++;
+        }, &ctx);
+
+        const int frameSize = instance.samplesPerFrame()*instance.sampleSizeOut();
+
+        CHECK(instance.init("ping", GGWAVE_PROTOCOL_AUDIBLE_FAST, 25));
+        const auto nBytes = instance.encode();
+        auto p = (const uint8_t *)(instance.txWaveform());
+        buffer.assign(p, p + nBytes);
+        buffer.insert(buffer.end(), 8*frameSize, 0);
+
+        int offset = 0;
+        while (instance.rxAnalysisInFlight() == false && offset < (int) buffer.size()) {
+            instance.decode(buffer.data() + offset, std::min(frameSize, (int) buffer.size() - offset));
+            offset += frameSize;
+        }
+
+        const std::vector<uint8_t> silence(frameSize, 0);
+        while (instance.rxAnalysisInFlight()) {
+            instance.decode(silence.data(), frameSize);
+            CHECK(instance.init("pong", GGWAVE_PROTOCOL_DT_FASTEST, 25));
+            CHECK(instance.encode() > 0);
+            ctx.nDecoded++;
+        }
+
+        ctx.thread.join();
+        CHECK(ctx.nReceived == 1);
+    }
+
+    // FFT backends - the output must match the DFT, in the layout of the Ooura rdft:
+    //   dst[2k] = sum x[j]*cos(2*pi*j*k/N), dst[2k + 1] = sum x[j]*sin(2*pi*j*k/N), dst[1] = real part of bin N/2
+    {
+        const std::string payload = "fft";
+
+        for (auto backend : { GGWAVE_FFT_BACKEND_OOURA, GGWAVE_FFT_BACKEND_SIMD }) {
+            GGWave::setFFTBackend(backend);
+            printf("FFT backend: %s\n", GGWave::fftBackendName());
+
+            for (int N = 2; N <= GGWave::kMaxSamplesPerFrame; N *= 2) {
+                std::vector<float> src(N);
+                std::vector<float> dst(2*N);
+                std::vector<int>   wi(GGWave::computeFFTR(nullptr, nullptr, N, nullptr, nullptr));
+                std::vector<float> wf(GGWave::computeFFTR(nullptr, nullptr, N, wi.data(), nullptr));
+
+                for (auto & x : src) x = frand() - 0.5f;
+                CHECK(GGWave::computeFFTR(src.data(), dst.data(), N, wi.data(), wf.data()) == 1);
+
+                for (int k = 0; k <= N/2; ++k) {
+                    double re = 0.0;
+                    double im = 0.0;
+                    for (int j = 0; j < N; ++j) {
+                        re += src[j]*cos(2.0*M_PI*j*k/N);
+                        im += src[j]*sin(2.0*M_PI*j*k/N);
+                    }
+                    if (k == 0) {
+                        CHECK(std::fabs(dst[0] - re) < 1e-5);
+                    } else if (k == N/2) {
+                        CHECK(std::fabs(dst[1] - re) < 1e-5);
+                    } else {
+                        CHECK(std::fabs(dst[2*k + 0] - re) < 1e-5);
+                        CHECK(std::fabs(dst[2*k + 1] - im) < 1e-5);
+                    }
+                }
+            }
+
+            // the sizes without a shared plan fall back to the tables in the work buffers
+            {
+                const int N = 2*GGWave::kMaxSamplesPerFrame;
+                std::vector<float> src(N, 1.0f);
+                std::vector<float> dst(2*N);
+                std::vector<int>   wi(GGWave::computeFFTR(nullptr, nullptr, N, nullptr, nullptr));
+                std::vector<float> wf(GGWave::computeFFTR(nullptr, nullptr, N, wi.data(), nullptr));
+                CHECK(GGWave::computeFFTR(src.data(), dst.data(), N, wi.data(), wf.data()) == 1);
+            }
+
+            // the transform of an instance is selected in prepare() and gives the same result
+            for (int N = 128; N <= GGWave::kMaxSamplesPerFrame; N *= 2) {
+                auto parameters = GGWave::getDefaultParameters();
+                parameters.samplesPerFrame = N;
+
+                std::vector<float> src(N);
+                std::vector<float> dst0(2*N);
+                std::vector<float> dst1(2*N);
+                std::vector<int>   wi(GGWave::computeFFTR(nullptr, nullptr, N, nullptr, nullptr));
+                std::vector<float> wf(GGWave::computeFFTR(nullptr, nullptr, N, wi.data(), nullptr));
+
+                for (auto & x : src) x = frand() - 0.5f;
+                CHECK(GGWave::computeFFTR(src.data(), dst0.data(), N, wi.data(), wf.data()) == 1);
+
+                GGWave instanceRx(parameters);
+                CHECK(instanceRx.computeFFTR(src.data(), dst1.data(), N));
+                CHECK(memcmp(dst0.data(), dst1.data(), N*sizeof(float)) == 0);
+
+                parameters.operatingMode = GGWAVE_OPERATING_MODE_TX;
+                GGWave instanceTx(parameters);
+                CHECK_F(instanceTx.computeFFTR(src.data(), dst1.data(), N));
+            }
+
+            // a batch gives each frame the result of computeFFTR(), also in-place
+            for (int N = 2; N <= GGWave::kMaxSamplesPerFrame; N *= 2) {
+                std::vector<int>   wi(GGWave::computeFFTR(nullptr, nullptr, N, nullptr, nullptr));
+                std::vector<float> wf(GGWave::computeFFTR(nullptr, nullptr, N, wi.data(), nullptr));
+                std::vector<float> wb(GGWave::computeFFTRBatch(nullptr, nullptr, N, 0, nullptr));
+
+                for (int count : { 1, 2, 3, 4, 5, 8, 11, 17 }) {
+                    std::vector<float> src(count*N);
+                    std::vector<float> dst0(count*N);
+                    std::vector<float> dst1(count*N);
+                    std::vector<float> tmp(2*N);
+
+                    for (auto & x : src) x = frand() - 0.5f;
+                    for (int i = 0; i < count; ++i) {
+                        CHECK(GGWave::computeFFTR(src.data() + i*N, tmp.data(), N, wi.data(), wf.data()) == 1);
+                        memcpy(dst0.data() + i*N, tmp.data(), N*sizeof(float));
+                    }
+
+                    CHECK(GGWave::computeFFTRBatch(src.data(), dst1.data(), N, count, wb.data()) == 1);
+                    CHECK(GGWave::computeFFTRBatch(src.data(), src.data(), N, count, wb.data()) == 1);
+                    for (int i = 0; i < count*N; ++i) {
+                        CHECK(dst1[i] == dst0[i]);
+                        CHECK(src[i]  == dst0[i]);
+                    }
+                }
+            }
+
+            {
+                std::vector<float> src(2*GGWave::kMaxSamplesPerFrame, 1.0f);
+                std::vector<float> dst(2*GGWave::kMaxSamplesPerFrame);
+                std::vector<float> wb(GGWave::computeFFTRBatch(nullptr, nullptr, 2*GGWave::kMaxSamplesPerFrame, 0, nullptr));
+                CHECK(GGWave::computeFFTRBatch(src.data(), dst.data(), 64, 0, wb.data()) == 1);
+                CHECK(GGWave::computeFFTRBatch(src.data(), dst.data(), 96, 1, wb.data()) == 0);
+                CHECK(GGWave::computeFFTRBatch(src.data(), dst.data(), 2*GGWave::kMaxSamplesPerFrame, 1, wb.data()) == 0);
+            }
+
+            GGWave instance(GGWave::getDefaultParameters());
+            CHECK(instance.init(payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25));
+            const auto nBytes = instance.encode();
+            CHECK(nBytes > 0);
+            instance.decode(instance.txWaveform(), nBytes);
+
+            GGWave::TxRxData result;
+            CHECK(instance.rxTakeData(result) == (int) payload.size());
+            CHECK(memcmp(result.data(), payload.data(), payload.size()) == 0);
+        }
+
+        GGWave::setFFTBackend(GGWAVE_FFT_BACKEND_DEFAULT);
+    }
+
+    // power spectrum - only the bins of the enabled Rx protocols are computed, the other bins are zero
+    //   with a narrow band, the bins come from the band transform, which matches the full one up to rounding - the error
+    //   is relative to the energy of the frame, which is the mean power of a bin
+    for (int N = 128; N <= GGWave::kMaxSamplesPerFrame; N *= 2) {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.payloadLength   = 4;
+        parameters.samplesPerFrame = N;
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+
+        GGWave instance(parameters);
+
+        // bin 0 also holds bin N/2
+        instance.rxProtocols()[GGWAVE_PROTOCOL_DT_FAST].freqStart = 0;
+
+        std::vector<float> frame(N);
+        std::vector<float> fftOut(2*N);
+        GGWave::Spectrum spectrum;
+
+        for (auto protocolIds : { std::vector<GGWave::ProtocolId> { GGWAVE_PROTOCOL_AUDIBLE_FAST },
+                                  std::vector<GGWave::ProtocolId> { GGWAVE_PROTOCOL_DT_FAST },
+                                  std::vector<GGWave::ProtocolId> { GGWAVE_PROTOCOL_AUDIBLE_FAST, GGWAVE_PROTOCOL_ULTRASOUND_FAST } }) {
+            instance.rxProtocols().only(protocolIds[0]);
+            for (auto protocolId : protocolIds) {
+                instance.rxProtocols()[protocolId].enabled = true;
+            }
+
+            int bin0 = N;
+            int bin1 = 0;
+            for (auto protocolId : protocolIds) {
+                const auto & protocol = instance.rxProtocols()[protocolId];
+                bin0 = std::min(bin0, (int) protocol.freqStart);
+                bin1 = std::max(bin1, protocol.freqStart + std::max(17, 2*16*protocol.bytesPerTx));
+            }
+
+            float energy = 0.0f;
+            for (auto & x : frame) {
+                x = frand() - 0.5f;
+                energy += x*x;
+            }
+
+            instance.decode(frame.data(), N*sizeof(float));
+            CHECK(instance.computeFFTR(frame.data(), fftOut.data(), N));
+            CHECK(instance.rxTakeSpectrum(spectrum));
+
+            for (int i = 0; i < N; ++i) {
+                if (i >= bin0 && i < std::min(bin1, N/2)) {
+                    const float power = fftOut[2*i + 0]*fftOut[2*i + 0] + fftOut[2*i + 1]*fftOut[2*i + 1];
+                    CHECK(std::fabs(spectrum[i] - power) <= 1e-6f*power + 1e-5f*energy);
+                } else {
+                    CHECK(spectrum[i] == 0.0f);
+                }
+            }
+        }
+    }
+
+    // sample conversion - full scale samples saturate, in the vectorized body and in the scalar tail
+    {
+        for (int n = 1; n <= 40; ++n) {
+            for (float x : { -1.0f, 1.0f }) {
+                std::vector<float> src(n, x);
+
+                std::vector<uint8_t>  u8(n);
+                std::vector<int8_t>   i8(n);
+                std::vector<uint16_t> u16(n);
+                std::vector<int16_t>  i16(n);
+
+                simd::kernels().convertU8 (src.data(), u8.data(),  n);
+                simd::kernels().convertI8 (src.data(), i8.data(),  n);
+                simd::kernels().convertU16(src.data(), u16.data(), n);
+                simd::kernels().convertI16(src.data(), i16.data(), n);
+
+                for (int i = 0; i < n; ++i) {
+                    CHECK(u8[i]  == (x > 0.0f ? 255   : 0));
+                    CHECK(i8[i]  == (x > 0.0f ? 127   : -128));
+                    CHECK(u16[i] == (x > 0.0f ? 65535 : 0));
+                    CHECK(i16[i] == (x > 0.0f ? 32767 : -32768));
+                }
+            }
+        }
+    }
+
+    // invalid resampler parameters
+    {
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.resamplerQuality = GGWave::Resampler::kMaxQuality + 1;
+        GGWave instance(parameters);
+        CHECK(instance.heapSize() == 0);
+    }
+
     const std::string payload = "a0Z5kR2g";
 
     // encode / decode using different sample formats and Tx protocols